@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * bench/jitter.c
+ *      The scheduler and memory benchmarks
+ */
+
+#include "main.h"
+
+static const struct {
+	const char *name;
+	int policy;
+} jitter_policies[] = {
+	{ "SCHED_OTHER", SCHED_OTHER },
+	{ "SCHED_FIFO", SCHED_FIFO },
+	{ "SCHED_RR", SCHED_RR }
+};
+
+static int run_policy(int policy, int priority, char *args[],
+	struct bench_result *result)
+{
+	posix_spawnattr_t attr;
+	struct sched_param param;
+	int result_fd[2];
+	pid_t pid;
+	int r;
+
+	if (bench_pipe(result_fd))
+		return 1;
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = (policy != SCHED_OTHER) ? priority : 0;
+
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr,
+		POSIX_SPAWN_SETSCHEDULER | POSIX_SPAWN_SETSCHEDPARAM);
+	posix_spawnattr_setschedpolicy(&attr, policy);
+	posix_spawnattr_setschedparam(&attr, &param);
+
+	r = bench_spawn(&pid, &attr, -1, result_fd[1], "jitter", args);
+
+	posix_spawnattr_destroy(&attr);
+	close(result_fd[1]);
+
+	if (r != 0)
+		return close(result_fd[0]), 1;
+
+	r = bench_read_result(result_fd[0], result);
+	close(result_fd[0]);
+
+	if (bench_wait(pid))
+		r = 1;
+
+	return r;
+}
+
+int jitter_main(struct options *opt)
+{
+	const int count = (int)(sizeof(jitter_policies) /
+		sizeof(*jitter_policies));
+	static char load_option[] = "load";
+	long samples = 1000, period = 10, priority = 50;
+	long load = (long)bench_nproc();
+	long spawned = 0, i;
+	char arg[2][32];
+	char *args[3];
+	char *load_args[2];
+	pid_t *pids;
+	int r = 0;
+
+	if (bench_number(bench_operand(opt, 1), 1, LONG_MAX, &samples))
+		return opt->error = "invalid number of samples", 1;
+
+	if (bench_number(bench_operand(opt, 2), 1, 60000, &period))
+		return opt->error = "invalid period", 1;
+
+	if (bench_number(bench_operand(opt, 3), 0, 4096, &load))
+		return opt->error = "invalid number of load tasks", 1;
+
+	if (bench_number(bench_operand(opt, 4), 1, 99, &priority))
+		return opt->error = "invalid priority", 1;
+
+	if (bench_operand(opt, 5) != NULL)
+		return opt->error = "too many operands", 1;
+
+	sprintf(&arg[0][0], "%ld", samples);
+	sprintf(&arg[1][0], "%ld", period);
+	args[0] = &arg[0][0];
+	args[1] = &arg[1][0];
+	args[2] = NULL;
+
+	load_args[0] = &load_option[0];
+	load_args[1] = NULL;
+
+	if ((pids = malloc((size_t)(load + 1) * sizeof(*pids))) == NULL) {
+		fputs(MAIN_CMDNAME ": out of memory\n", stderr);
+		return 1;
+	}
+
+	/*
+	 * The load tasks keep all processors busy, so that a waking
+	 * task has to preempt or wait for one of them.
+	 */
+	for (i = 0; i < load; i++) {
+		if (bench_spawn(&pids[i], NULL, -1, -1, "jitter", load_args)) {
+			r = 1;
+			break;
+		}
+		spawned += 1;
+	}
+
+	printf("samples: %ld, period: %ld ms, load tasks: %ld\n",
+		samples, period, spawned);
+
+	for (i = 0; r == 0 && i < count; i++) {
+		struct bench_result result;
+		int policy = jitter_policies[i].policy;
+
+		if ((r = run_policy(policy, (int)priority, args, &result)))
+			break;
+
+		bench_print_result(jitter_policies[i].name, &result);
+	}
+
+	for (i = 0; i < spawned; i++) {
+		int status;
+
+		kill(pids[i], SIGKILL);
+
+		while (waitpid(pids[i], &status, 0) == -1) {
+			if (errno != EINTR)
+				break;
+		}
+	}
+
+	free(pids);
+
+	return r;
+}
+
+static int jitter_load(void)
+{
+	volatile int running = 1;
+	volatile unsigned long n = 0;
+
+	/*
+	 * The task runs until the parent kills it.
+	 */
+	while (running)
+		n += 1;
+
+	return 0;
+}
+
+int jitter_worker(struct options *opt)
+{
+	const char *arg = bench_operand(opt, 1);
+	struct bench_result result;
+	long samples = 1000, period = 10, i;
+	long long t, target;
+
+	if (arg != NULL && !strcmp(arg, "load"))
+		return jitter_load();
+
+	if (bench_number(arg, 1, LONG_MAX, &samples))
+		return 1;
+
+	if (bench_number(bench_operand(opt, 2), 1, 60000, &period))
+		return 1;
+
+	memset(&result, 0, sizeof(result));
+	target = bench_clock();
+
+	/*
+	 * The absolute wakeup times do not drift, and the lateness
+	 * is measured from the time that was requested.
+	 */
+	for (i = 0; i < samples; i++) {
+		struct timespec request;
+		int r;
+
+		target += (long long)period * 1000000;
+		request.tv_sec = (time_t)(target / 1000000000);
+		request.tv_nsec = (long)(target % 1000000000);
+
+		do {
+			r = clock_nanosleep(CLOCK_MONOTONIC,
+				TIMER_ABSTIME, &request, NULL);
+		} while (r == EINTR);
+
+		if (r != 0) {
+			fprintf(stderr, MAIN_CMDNAME
+				": clock_nanosleep: %s\n", strerror(r));
+			return 1;
+		}
+
+		if ((t = bench_clock() - target) < 0)
+			t = 0;
+
+		if (result.max_ns < t)
+			result.max_ns = t;
+		result.total_ns += t;
+	}
+
+	result.count = samples;
+
+	return bench_write_result(1, &result);
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * bench/main.h
+ *      The scheduler and memory benchmarks
+ */
+
+#ifndef MAIN_CMDNAME
+#define MAIN_CMDNAME "bench"
+
+#include <__dancy/proc.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+struct options {
+	char **operands;
+	const char *error;
+	int verbose;
+	int worker;
+};
+
+struct bench_result {
+	long long count;
+	long long total_ns;
+	long long max_ns;
+};
+
+int operate(struct options *opt);
+
+long long bench_clock(void);
+const char *bench_operand(struct options *opt, int i);
+int bench_number(const char *arg, long min, long max, long *value);
+int bench_nproc(void);
+int bench_pipe(int fd[2]);
+int bench_spawn(pid_t *pid, const posix_spawnattr_t *attrp,
+	int fd_in, int fd_out, const char *test, char *args[]);
+int bench_wait(pid_t pid);
+int bench_wait_start(void);
+
+int bench_read_result(int fd, struct bench_result *result);
+int bench_write_result(int fd, const struct bench_result *result);
+void bench_add_result(struct bench_result *sum,
+	const struct bench_result *result);
+void bench_print_result(const char *name, const struct bench_result *result);
+
+int jitter_main(struct options *opt);
+int jitter_worker(struct options *opt);
+
+int mmap_main(struct options *opt);
+int mmap_worker(struct options *opt);
+
+int pingpong_main(struct options *opt);
+int pingpong_worker(struct options *opt);
+
+int read_main(struct options *opt);
+int syscall_main(struct options *opt);
+
+int yield_main(struct options *opt);
+int yield_worker(struct options *opt);
+
+#else
+#error "MAIN_CMDNAME"
+#endif
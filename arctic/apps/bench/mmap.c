@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * bench/mmap.c
+ *      The scheduler and memory benchmarks
+ */
+
+#include "main.h"
+
+#define BENCH_PAGE_SIZE 4096
+
+static int spawn_worker(pid_t *pid, long i, long nproc,
+	int fd_in, int fd_out, char *args[])
+{
+	posix_spawnattr_t attr;
+	int r;
+
+	posix_spawnattr_init(&attr);
+
+	/*
+	 * Each worker is bound to its own processor if there are
+	 * enough of them. Otherwise the scheduler decides.
+	 */
+	if (i < nproc && i < 64) {
+		posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETAFFINITY_NP);
+		posix_spawnattr_setaffinity_np(&attr, 1ull << i);
+	}
+
+	r = bench_spawn(pid, &attr, fd_in, fd_out, "mmap", args);
+	posix_spawnattr_destroy(&attr);
+
+	return r;
+}
+
+int mmap_main(struct options *opt)
+{
+	long nproc = (long)bench_nproc();
+	long workers = nproc, iterations = 10000, pages = 16;
+	long spawned = 0, i;
+	struct bench_result sum;
+	int start_fd[2], result_fd[2];
+	long long t0, t1;
+	char arg[2][32];
+	char *args[3];
+	pid_t *pids;
+	int r = 0;
+
+	if (bench_number(bench_operand(opt, 1), 1, 4096, &workers))
+		return opt->error = "invalid number of workers", 1;
+
+	if (bench_number(bench_operand(opt, 2), 1, LONG_MAX, &iterations))
+		return opt->error = "invalid number of iterations", 1;
+
+	if (bench_number(bench_operand(opt, 3), 1, 65536, &pages))
+		return opt->error = "invalid number of pages", 1;
+
+	if (bench_operand(opt, 4) != NULL)
+		return opt->error = "too many operands", 1;
+
+	sprintf(&arg[0][0], "%ld", iterations);
+	sprintf(&arg[1][0], "%ld", pages);
+	args[0] = &arg[0][0];
+	args[1] = &arg[1][0];
+	args[2] = NULL;
+
+	if ((pids = malloc((size_t)workers * sizeof(*pids))) == NULL) {
+		fputs(MAIN_CMDNAME ": out of memory\n", stderr);
+		return 1;
+	}
+
+	if (bench_pipe(start_fd))
+		return free(pids), 1;
+
+	if (bench_pipe(result_fd)) {
+		close(start_fd[0]), close(start_fd[1]);
+		return free(pids), 1;
+	}
+
+	for (i = 0; i < workers; i++) {
+		if (spawn_worker(&pids[i], i, nproc,
+		    start_fd[0], result_fd[1], args)) {
+			r = 1;
+			break;
+		}
+		spawned += 1;
+	}
+
+	close(start_fd[0]);
+	close(result_fd[1]);
+
+	t0 = bench_clock();
+	close(start_fd[1]);
+
+	memset(&sum, 0, sizeof(sum));
+
+	for (i = 0; i < spawned; i++) {
+		struct bench_result result;
+
+		if (bench_read_result(result_fd[0], &result)) {
+			r = 1;
+			break;
+		}
+		bench_add_result(&sum, &result);
+	}
+
+	t1 = bench_clock();
+	close(result_fd[0]);
+
+	for (i = 0; i < spawned; i++) {
+		if (bench_wait(pids[i]))
+			r = 1;
+	}
+
+	free(pids);
+
+	printf("workers: %ld, iterations: %ld, pages: %ld\n",
+		spawned, iterations, pages);
+	bench_print_result("mmap/munmap", &sum);
+
+	if (t1 > t0) {
+		long long ms = (t1 - t0) / 1000000;
+		long long n = (sum.count * 1000000000LL) / (t1 - t0);
+
+		printf("elapsed: %lld ms, %lld mappings per second\n", ms, n);
+	}
+
+	return r;
+}
+
+int mmap_worker(struct options *opt)
+{
+	const int prot = PROT_READ | PROT_WRITE;
+	const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	struct bench_result result;
+	long iterations = 10000, pages = 16, i, j;
+	unsigned char *base, *p;
+	long long t0, t;
+	size_t size;
+
+	if (bench_number(bench_operand(opt, 1), 1, LONG_MAX, &iterations))
+		return 1;
+
+	if (bench_number(bench_operand(opt, 2), 1, 65536, &pages))
+		return 1;
+
+	size = (size_t)pages * BENCH_PAGE_SIZE;
+
+	/*
+	 * Reserve an address range for the MAP_FIXED mappings. The
+	 * range is unmapped at the end of every iteration.
+	 */
+	if ((base = mmap(NULL, size, prot, flags, -1, 0)) == MAP_FAILED) {
+		perror(MAIN_CMDNAME ": mmap");
+		return 1;
+	}
+
+	if (munmap(base, size) != 0) {
+		perror(MAIN_CMDNAME ": munmap");
+		return 1;
+	}
+
+	if (bench_wait_start())
+		return 1;
+
+	memset(&result, 0, sizeof(result));
+	t0 = t = bench_clock();
+
+	for (i = 0; i < iterations; i++) {
+		long long t_next;
+
+		p = mmap(base, size, prot, flags | MAP_FIXED, -1, 0);
+
+		if (p == MAP_FAILED) {
+			perror(MAIN_CMDNAME ": mmap");
+			return 1;
+		}
+
+		/*
+		 * Touch every page, so that the page frames are
+		 * allocated and then freed again by munmap.
+		 */
+		for (j = 0; j < pages; j++)
+			p[j * BENCH_PAGE_SIZE] = (unsigned char)i;
+
+		if (munmap(p, size) != 0) {
+			perror(MAIN_CMDNAME ": munmap");
+			return 1;
+		}
+
+		t_next = bench_clock();
+
+		if (result.max_ns < t_next - t)
+			result.max_ns = t_next - t;
+		t = t_next;
+	}
+
+	result.count = iterations;
+	result.total_ns = t - t0;
+
+	return bench_write_result(1, &result);
+}
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * bench/operate.c
+ *      The scheduler and memory benchmarks
+ */
+
+#include "main.h"
+
+static const struct {
+	const char *name;
+	int (*run)(struct options *opt);
+	int (*worker)(struct options *opt);
+} bench_tests[] = {
+	{ "jitter", jitter_main, jitter_worker },
+	{ "mmap", mmap_main, mmap_worker },
+	{ "pingpong", pingpong_main, pingpong_worker },
+	{ "read", read_main, NULL },
+	{ "syscall", syscall_main, NULL },
+	{ "yield", yield_main, yield_worker }
+};
+
+static char bench_path[256];
+
+static int get_path(void)
+{
+	const int request = __DANCY_PROCINFO_CMDLINE;
+	const size_t size = sizeof(bench_path) - 1;
+	ssize_t r;
+
+	/*
+	 * The command line starts with the absolute path of the
+	 * executable. The workers are spawned from the same file.
+	 */
+	r = __dancy_procinfo(getpid(), request, &bench_path[0], size);
+
+	if (r <= 0 || bench_path[0] != '/') {
+		fputs(MAIN_CMDNAME ": executable path not found\n", stderr);
+		return 1;
+	}
+
+	return 0;
+}
+
+long long bench_clock(void)
+{
+	struct timespec tp = { 0, 0 };
+
+	if (clock_gettime(CLOCK_MONOTONIC, &tp) != 0)
+		return 0;
+
+	return (long long)tp.tv_sec * 1000000000LL + (long long)tp.tv_nsec;
+}
+
+const char *bench_operand(struct options *opt, int i)
+{
+	int j;
+
+	for (j = 0; j < i; j++) {
+		if (opt->operands[j] == NULL)
+			return NULL;
+	}
+
+	return opt->operands[i];
+}
+
+int bench_number(const char *arg, long min, long max, long *value)
+{
+	char *end = NULL;
+	long v;
+
+	if (arg == NULL)
+		return 0;
+
+	errno = 0;
+	v = strtol(arg, &end, 0);
+
+	if (errno != 0 || end == arg || *end != '\0')
+		return 1;
+
+	if (v < min || v > max)
+		return 1;
+
+	return *value = v, 0;
+}
+
+int bench_nproc(void)
+{
+	int smp_ap_count = 0;
+	ssize_t r;
+
+	r = __dancy_procinfo(getpid(), __DANCY_PROCINFO_SMP_AP_COUNT,
+		&smp_ap_count, sizeof(smp_ap_count));
+
+	if (r != (ssize_t)(sizeof(smp_ap_count)))
+		smp_ap_count = 0;
+
+	return smp_ap_count + 1;
+}
+
+int bench_pipe(int fd[2])
+{
+	if (pipe(fd) != 0) {
+		perror(MAIN_CMDNAME ": pipe");
+		return 1;
+	}
+
+	if (fcntl(fd[0], F_SETFD, FD_CLOEXEC) == -1
+	    || fcntl(fd[1], F_SETFD, FD_CLOEXEC) == -1) {
+		perror(MAIN_CMDNAME ": fcntl");
+		close(fd[0]), close(fd[1]);
+		return 1;
+	}
+
+	return 0;
+}
+
+int bench_spawn(pid_t *pid, const posix_spawnattr_t *attrp,
+	int fd_in, int fd_out, const char *test, char *args[])
+{
+	static char worker_option[] = "--worker";
+	posix_spawn_file_actions_t actions;
+	char *argv[8];
+	int i, r;
+
+	argv[0] = &bench_path[0];
+	argv[1] = &worker_option[0];
+	argv[2] = (char *)test;
+
+	for (i = 3; i < 7 && args[i - 3] != NULL; i++)
+		argv[i] = args[i - 3];
+
+	argv[i] = NULL;
+
+	posix_spawn_file_actions_init(&actions);
+
+	if (fd_in >= 0)
+		posix_spawn_file_actions_adddup2(&actions, fd_in, 0);
+	if (fd_out >= 0)
+		posix_spawn_file_actions_adddup2(&actions, fd_out, 1);
+
+	r = posix_spawn(pid, &bench_path[0], &actions, attrp, argv, NULL);
+
+	posix_spawn_file_actions_destroy(&actions);
+
+	if (r != 0) {
+		fprintf(stderr, MAIN_CMDNAME
+			": posix_spawn: %s\n", strerror(r));
+		return 1;
+	}
+
+	return 0;
+}
+
+int bench_wait(pid_t pid)
+{
+	int status = 0;
+
+	while (waitpid(pid, &status, 0) == -1) {
+		if (errno != EINTR) {
+			perror(MAIN_CMDNAME ": waitpid");
+			return 1;
+		}
+	}
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		return 1;
+
+	return 0;
+}
+
+int bench_wait_start(void)
+{
+	unsigned char b;
+	ssize_t r;
+
+	/*
+	 * The parent closes the write end of the pipe when all
+	 * workers have been spawned. Nothing is ever written.
+	 */
+	while ((r = read(0, &b, 1)) != 0) {
+		if (r < 0 && errno != EINTR)
+			return 1;
+	}
+
+	return 0;
+}
+
+int bench_read_result(int fd, struct bench_result *result)
+{
+	unsigned char *ptr = (unsigned char *)result;
+	size_t size = 0;
+
+	while (size < sizeof(*result)) {
+		ssize_t r = read(fd, ptr + size, sizeof(*result) - size);
+
+		if (r < 0 && errno == EINTR)
+			continue;
+
+		if (r <= 0)
+			return 1;
+
+		size += (size_t)r;
+	}
+
+	return 0;
+}
+
+int bench_write_result(int fd, const struct bench_result *result)
+{
+	const unsigned char *ptr = (const unsigned char *)result;
+	size_t size = 0;
+
+	/*
+	 * The result structure is smaller than the atomic write size
+	 * of the pipes, so the workers can share the same pipe.
+	 */
+	while (size < sizeof(*result)) {
+		ssize_t w = write(fd, ptr + size, sizeof(*result) - size);
+
+		if (w < 0 && errno == EINTR)
+			continue;
+
+		if (w <= 0)
+			return 1;
+
+		size += (size_t)w;
+	}
+
+	return 0;
+}
+
+void bench_add_result(struct bench_result *sum,
+	const struct bench_result *result)
+{
+	sum->count += result->count;
+	sum->total_ns += result->total_ns;
+
+	if (sum->max_ns < result->max_ns)
+		sum->max_ns = result->max_ns;
+}
+
+void bench_print_result(const char *name, const struct bench_result *result)
+{
+	long long average = 0;
+
+	if (result->count > 0)
+		average = result->total_ns / result->count;
+
+	printf("%s: %lld operations, %lld ns average, %lld ns maximum\n",
+		name, result->count, average, result->max_ns);
+}
+
+int operate(struct options *opt)
+{
+	const int count = (int)(sizeof(bench_tests) / sizeof(*bench_tests));
+	const char *test = opt->operands[0];
+	int i;
+
+	if (test == NULL)
+		return opt->error = "missing test", 1;
+
+	for (i = 0; i < count; i++) {
+		if (strcmp(test, bench_tests[i].name))
+			continue;
+
+		if (get_path())
+			return 1;
+
+		if (opt->worker) {
+			if (bench_tests[i].worker == NULL)
+				return opt->error = "no worker task", 1;
+			return bench_tests[i].worker(opt);
+		}
+
+		return bench_tests[i].run(opt);
+	}
+
+	return opt->error = "unknown test", 1;
+}
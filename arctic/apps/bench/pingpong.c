@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * bench/pingpong.c
+ *      The scheduler and memory benchmarks
+ */
+
+#include "main.h"
+
+static volatile double fpu_value = 1.0;
+
+static void use_fpu(void)
+{
+	fpu_value = fpu_value * 0.5 + 1.0;
+}
+
+static int transfer(int fd, int write_mode)
+{
+	unsigned char b = 0;
+
+	for (;;) {
+		ssize_t r;
+
+		if (write_mode)
+			r = write(fd, &b, 1);
+		else
+			r = read(fd, &b, 1);
+
+		if (r < 0 && errno == EINTR)
+			continue;
+
+		return (r == 1) ? 0 : 1;
+	}
+}
+
+static int run_mode(const char *mode, long round_trips,
+	struct bench_result *result)
+{
+	const unsigned long long mask = 1;
+	int fpu = !strcmp(mode, "fpu");
+	posix_spawnattr_t attr;
+	int request_fd[2], reply_fd[2];
+	char *args[2];
+	long long t0, t;
+	pid_t pid;
+	long i;
+	int r;
+
+	if (bench_pipe(request_fd))
+		return 1;
+
+	if (bench_pipe(reply_fd)) {
+		close(request_fd[0]), close(request_fd[1]);
+		return 1;
+	}
+
+	args[0] = (char *)mode;
+	args[1] = NULL;
+
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETAFFINITY_NP);
+	posix_spawnattr_setaffinity_np(&attr, mask);
+
+	r = bench_spawn(&pid, &attr, request_fd[0], reply_fd[1],
+		"pingpong", args);
+
+	posix_spawnattr_destroy(&attr);
+	close(request_fd[0]);
+	close(reply_fd[1]);
+
+	if (r != 0) {
+		close(request_fd[1]), close(reply_fd[0]);
+		return 1;
+	}
+
+	memset(result, 0, sizeof(*result));
+	t0 = t = bench_clock();
+
+	for (i = 0; r == 0 && i < round_trips; i++) {
+		long long t_next;
+
+		if (fpu)
+			use_fpu();
+
+		if (transfer(request_fd[1], 1) || transfer(reply_fd[0], 0)) {
+			fputs(MAIN_CMDNAME ": pipe transfer failed\n", stderr);
+			r = 1;
+			break;
+		}
+
+		t_next = bench_clock();
+
+		if (result->max_ns < t_next - t)
+			result->max_ns = t_next - t;
+		t = t_next;
+	}
+
+	result->count = i;
+	result->total_ns = t - t0;
+
+	close(request_fd[1]);
+	close(reply_fd[0]);
+
+	if (bench_wait(pid))
+		r = 1;
+
+	return r;
+}
+
+int pingpong_main(struct options *opt)
+{
+	static const char *modes[] = { "integer", "fpu" };
+	const unsigned long long mask = 1;
+	long round_trips = 100000;
+	int i, r = 0;
+
+	if (bench_number(bench_operand(opt, 1), 1, LONG_MAX, &round_trips))
+		return opt->error = "invalid number of round trips", 1;
+
+	if (bench_operand(opt, 2) != NULL)
+		return opt->error = "too many operands", 1;
+
+	/*
+	 * Both tasks run on the bootstrap processor, so that every
+	 * round trip is two task switches on the same processor.
+	 */
+	if (__dancy_setaffinity(getpid(), mask) != 0) {
+		perror(MAIN_CMDNAME ": __dancy_setaffinity");
+		return 1;
+	}
+
+	printf("round trips: %ld\n", round_trips);
+
+	for (i = 0; r == 0 && i < 2; i++) {
+		struct bench_result result;
+
+		if ((r = run_mode(modes[i], round_trips, &result)) != 0)
+			break;
+
+		bench_print_result(modes[i], &result);
+	}
+
+	return r;
+}
+
+int pingpong_worker(struct options *opt)
+{
+	const char *mode = bench_operand(opt, 1);
+	int fpu = (mode != NULL && !strcmp(mode, "fpu"));
+
+	/*
+	 * Reply to every byte until the parent closes the pipe.
+	 */
+	while (transfer(0, 0) == 0) {
+		if (fpu)
+			use_fpu();
+
+		if (transfer(1, 1))
+			return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * bench/syscall.c
+ *      The scheduler and memory benchmarks
+ */
+
+#include "main.h"
+
+int syscall_main(struct options *opt)
+{
+	struct bench_result result;
+	long iterations = 1000000, i;
+	long long t0, t;
+
+	if (bench_number(bench_operand(opt, 1), 1, LONG_MAX, &iterations))
+		return opt->error = "invalid number of iterations", 1;
+
+	if (bench_operand(opt, 2) != NULL)
+		return opt->error = "too many operands", 1;
+
+	memset(&result, 0, sizeof(result));
+	t0 = t = bench_clock();
+
+	/*
+	 * The getppid function is a system call that does almost
+	 * nothing, so the loop measures the kernel entry and exit.
+	 */
+	for (i = 0; i < iterations; i++) {
+		long long t_next;
+
+		(void)getppid();
+		t_next = bench_clock();
+
+		if (result.max_ns < t_next - t)
+			result.max_ns = t_next - t;
+		t = t_next;
+	}
+
+	result.count = iterations;
+	result.total_ns = t - t0;
+
+	printf("iterations: %ld\n", iterations);
+	bench_print_result("getppid", &result);
+
+	return 0;
+}
+
+static int read_file(const char *path, unsigned char *buffer, size_t size,
+	struct bench_result *result)
+{
+	long long t0, t;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		fprintf(stderr, MAIN_CMDNAME ": %s: %s\n",
+			path, strerror(errno));
+		return 1;
+	}
+
+	memset(result, 0, sizeof(*result));
+	t0 = t = bench_clock();
+
+	for (;;) {
+		ssize_t r = read(fd, buffer, size);
+		long long t_next;
+
+		if (r < 0 && errno == EINTR)
+			continue;
+
+		if (r < 0) {
+			fprintf(stderr, MAIN_CMDNAME ": %s: %s\n",
+				path, strerror(errno));
+			return close(fd), 1;
+		}
+
+		if (r == 0)
+			break;
+
+		t_next = bench_clock();
+
+		if (result->max_ns < t_next - t)
+			result->max_ns = t_next - t;
+		t = t_next;
+
+		result->count += (long long)r;
+	}
+
+	result->total_ns = t - t0;
+
+	return close(fd), 0;
+}
+
+int read_main(struct options *opt)
+{
+	const char *path = bench_operand(opt, 1);
+	long block = 64;
+	unsigned char *buffer;
+	int i, r = 0;
+
+	if (path == NULL)
+		return opt->error = "missing file operand", 1;
+
+	if (bench_number(bench_operand(opt, 2), 1, 16384, &block))
+		return opt->error = "invalid block size", 1;
+
+	if (bench_operand(opt, 3) != NULL)
+		return opt->error = "too many operands", 1;
+
+	if ((buffer = malloc((size_t)block * 1024)) == NULL) {
+		fputs(MAIN_CMDNAME ": out of memory\n", stderr);
+		return 1;
+	}
+
+	/*
+	 * The first pass reads from the device, unless the blocks are
+	 * already cached. The second pass shows the cached case.
+	 */
+	for (i = 0; r == 0 && i < 2; i++) {
+		struct bench_result result;
+		long long kib_per_second = 0;
+
+		if ((r = read_file(path, buffer, (size_t)block * 1024,
+		    &result)) != 0)
+			break;
+
+		if (result.total_ns > 0) {
+			kib_per_second = (result.count * 1000000000LL)
+				/ (result.total_ns * 1024);
+		}
+
+		printf("pass %d: %lld bytes, %lld ms, %lld KiB/s, "
+			"%lld ns maximum per %ld KiB block\n",
+			i + 1, result.count, result.total_ns / 1000000,
+			kib_per_second, result.max_ns, block);
+	}
+
+	free(buffer);
+
+	return r;
+}
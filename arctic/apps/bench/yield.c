@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * bench/yield.c
+ *      The scheduler and memory benchmarks
+ */
+
+#include "main.h"
+
+int yield_main(struct options *opt)
+{
+	long tasks = 1000, iterations = 1000;
+	long spawned = 0, i;
+	struct bench_result sum;
+	int start_fd[2], result_fd[2];
+	long long t0, t1;
+	char arg[32];
+	char *args[2];
+	pid_t *pids;
+	int r = 0;
+
+	if (bench_number(bench_operand(opt, 1), 1, 65536, &tasks))
+		return opt->error = "invalid number of tasks", 1;
+
+	if (bench_number(bench_operand(opt, 2), 1, LONG_MAX, &iterations))
+		return opt->error = "invalid number of iterations", 1;
+
+	if (bench_operand(opt, 3) != NULL)
+		return opt->error = "too many operands", 1;
+
+	sprintf(&arg[0], "%ld", iterations);
+	args[0] = &arg[0];
+	args[1] = NULL;
+
+	if ((pids = malloc((size_t)tasks * sizeof(*pids))) == NULL) {
+		fputs(MAIN_CMDNAME ": out of memory\n", stderr);
+		return 1;
+	}
+
+	if (bench_pipe(start_fd))
+		return free(pids), 1;
+
+	if (bench_pipe(result_fd)) {
+		close(start_fd[0]), close(start_fd[1]);
+		return free(pids), 1;
+	}
+
+	for (i = 0; i < tasks; i++) {
+		if (bench_spawn(&pids[i], NULL, start_fd[0], result_fd[1],
+		    "yield", args)) {
+			r = 1;
+			break;
+		}
+		spawned += 1;
+	}
+
+	close(start_fd[0]);
+	close(result_fd[1]);
+
+	t0 = bench_clock();
+	close(start_fd[1]);
+
+	memset(&sum, 0, sizeof(sum));
+
+	for (i = 0; i < spawned; i++) {
+		struct bench_result result;
+
+		if (bench_read_result(result_fd[0], &result)) {
+			r = 1;
+			break;
+		}
+		bench_add_result(&sum, &result);
+	}
+
+	t1 = bench_clock();
+	close(result_fd[0]);
+
+	for (i = 0; i < spawned; i++) {
+		if (bench_wait(pids[i]))
+			r = 1;
+	}
+
+	free(pids);
+
+	printf("tasks: %ld, iterations: %ld\n", spawned, iterations);
+	bench_print_result("sched_yield", &sum);
+
+	if (t1 > t0) {
+		long long ms = (t1 - t0) / 1000000;
+		long long n = (sum.count * 1000000000LL) / (t1 - t0);
+
+		printf("elapsed: %lld ms, %lld yields per second\n", ms, n);
+	}
+
+	return r;
+}
+
+int yield_worker(struct options *opt)
+{
+	struct bench_result result;
+	long iterations = 1000, i;
+	long long t0, t;
+
+	if (bench_number(bench_operand(opt, 1), 1, LONG_MAX, &iterations))
+		return 1;
+
+	if (bench_wait_start())
+		return 1;
+
+	memset(&result, 0, sizeof(result));
+	t0 = t = bench_clock();
+
+	/*
+	 * The time between two samples is how long the task waited
+	 * for its next turn after giving up the processor.
+	 */
+	for (i = 0; i < iterations; i++) {
+		long long t_next;
+
+		sched_yield();
+		t_next = bench_clock();
+
+		if (result.max_ns < t_next - t)
+			result.max_ns = t_next - t;
+		t = t_next;
+	}
+
+	result.count = iterations;
+	result.total_ns = t - t0;
+
+	return bench_write_result(1, &result);
+}
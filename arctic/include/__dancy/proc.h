@@ -36,10 +36,41 @@ typedef __dancy_pid_t pid_t;
 #define __DANCY_PROCINFO_CMDLINE        (0x1003)
 #define __DANCY_PROCINFO_MEMORY         (0x1004)
 #define __DANCY_PROCINFO_SMP_AP_COUNT   (0x1005)
+#define __DANCY_PROCINFO_CPU_TIME       (0x1006)
+#define __DANCY_PROCINFO_AFFINITY       (0x1007)
+#define __DANCY_PROCINFO_BLOCK_CACHE    (0x1008)
+#define __DANCY_PROCINFO_HEAP_CACHE     (0x1009)
+
+struct __dancy_cpu_time {
+	unsigned long long user_ns;
+	unsigned long long system_ns;
+	unsigned long long child_user_ns;
+	unsigned long long child_system_ns;
+	unsigned long long switches;
+	unsigned long long wakeups;
+};
+
+struct __dancy_block_cache {
+	unsigned long long device;
+	unsigned long long hits;
+	unsigned long long misses;
+	unsigned long long blocks;
+	unsigned long long block_size;
+};
+
+struct __dancy_heap_cache {
+	unsigned long long object_size;
+	unsigned long long slabs;
+	unsigned long long objects;
+	unsigned long long free_objects;
+	unsigned long long magazine_objects;
+};
 
 ssize_t __dancy_proclist(pid_t *buffer, size_t size);
 ssize_t __dancy_procinfo(pid_t pid, int request, void *buffer, size_t size);
 
+int __dancy_setaffinity(pid_t pid, unsigned long long mask);
+
 __Dancy_Header_End
 
 #endif
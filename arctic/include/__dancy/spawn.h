@@ -47,6 +47,7 @@ struct __dancy_spawn_file_actions {
 #define __DANCY_SPAWN_SETSCHEDULER    (0x0020)
 #define __DANCY_SPAWN_USEVFORK        (0x0040)
 #define __DANCY_SPAWN_SETSID          (0x0080)
+#define __DANCY_SPAWN_SETAFFINITY_NP  (0x0100)
 
 struct __dancy_spawn_attributes {
 	unsigned int _state;
@@ -55,7 +56,7 @@ struct __dancy_spawn_attributes {
 	unsigned long long _sigdef;
 	unsigned long long _sigmask;
 	int _sched[2];
-	int _other[2];
+	unsigned long long _affinity;
 };
 
 struct __dancy_spawn_options {
@@ -348,6 +348,18 @@ enum __dancy_syscall_enum__ {
 	 */
 	__dancy_syscall_arctic,
 
+	/*
+	 * long long __dancy_syscall_yield(void);
+	 */
+	__dancy_syscall_yield,
+
+	/*
+	 * long long __dancy_syscall_setaffinity(
+	 *         pid_t pid,
+	 *         const unsigned long long *mask);
+	 */
+	__dancy_syscall_setaffinity,
+
 	__dancy_syscall_argn__
 };
 
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * sched.h
+ *      Execution scheduling
+ */
+
+#ifndef __DANCY_SCHED_H
+#define __DANCY_SCHED_H
+
+#include <__dancy/core.h>
+#include <__dancy/sched.h>
+
+__Dancy_Header_Begin
+
+#define SCHED_OTHER     __DANCY_SCHED_OTHER
+#define SCHED_FIFO      __DANCY_SCHED_FIFO
+#define SCHED_RR        __DANCY_SCHED_RR
+
+int sched_yield(void);
+
+__Dancy_Header_End
+
+#endif
@@ -49,6 +49,7 @@ typedef __dancy_sigset_t sigset_t;
 #define POSIX_SPAWN_SETSCHEDULER    __DANCY_SPAWN_SETSCHEDULER
 #define POSIX_SPAWN_USEVFORK        __DANCY_SPAWN_USEVFORK
 #define POSIX_SPAWN_SETSID          __DANCY_SPAWN_SETSID
+#define POSIX_SPAWN_SETAFFINITY_NP  __DANCY_SPAWN_SETAFFINITY_NP
 
 typedef struct __dancy_spawn_file_actions
 	posix_spawn_file_actions_t;
@@ -115,6 +116,12 @@ int posix_spawnattr_getsigmask(
 int posix_spawnattr_setsigmask(
 	posix_spawnattr_t *attrp, const sigset_t *sigmask);
 
+int posix_spawnattr_getaffinity_np(
+	const posix_spawnattr_t *attrp, unsigned long long *mask);
+
+int posix_spawnattr_setaffinity_np(
+	posix_spawnattr_t *attrp, unsigned long long mask);
+
 __Dancy_Header_End
 
 #endif
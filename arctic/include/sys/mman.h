@@ -46,6 +46,7 @@ typedef __dancy_off_t off_t;
 
 #define MAP_ANON        __DANCY_MAP_ANON
 #define MAP_ANONYMOUS   __DANCY_MAP_ANONYMOUS
+#define MAP_HUGETLB     __DANCY_MAP_HUGETLB
 
 #define MS_ASYNC        __DANCY_MS_ASYNC
 #define MS_INVALIDATE   __DANCY_MS_INVALIDATE
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * libc/misc/setaffinity.c
+ *      Set the processor affinity of a process
+ */
+
+#include <__dancy/proc.h>
+#include <__dancy/syscall.h>
+#include <errno.h>
+
+int __dancy_setaffinity(pid_t pid, unsigned long long mask)
+{
+	long long r;
+
+	r = __dancy_syscall2e(__dancy_syscall_setaffinity, pid, &mask);
+
+	if (r < 0)
+		return (errno = -((int)r)), -1;
+
+	return 0;
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * libc/spawn/affinity.c
+ *      The spawn attribute functions
+ */
+
+#include <spawn.h>
+
+int posix_spawnattr_getaffinity_np(
+	const posix_spawnattr_t *attrp, unsigned long long *mask)
+{
+	return (*mask = attrp->_affinity), 0;
+}
+
+int posix_spawnattr_setaffinity_np(
+	posix_spawnattr_t *attrp, unsigned long long mask)
+{
+	return (attrp->_affinity = mask), 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * libc/sys/times.c
+ *      Get the process times
+ */
+
+#include <__dancy/proc.h>
+#include <sys/times.h>
+#include <time.h>
+#include <unistd.h>
+
+clock_t times(struct tms *buffer)
+{
+	const int request = __DANCY_PROCINFO_CPU_TIME;
+	const clock_t ns = (clock_t)1000000000 / CLOCKS_PER_SEC;
+	struct __dancy_cpu_time cpu_time;
+	struct timespec t;
+	ssize_t size;
+
+	size = __dancy_procinfo(getpid(), request, &cpu_time, sizeof(cpu_time));
+
+	if (size != (ssize_t)sizeof(cpu_time))
+		return (clock_t)(-1);
+
+	if (clock_gettime(CLOCK_MONOTONIC, &t) != 0)
+		return (clock_t)(-1);
+
+	buffer->tms_utime = (clock_t)cpu_time.user_ns / ns;
+	buffer->tms_stime = (clock_t)cpu_time.system_ns / ns;
+	buffer->tms_cutime = (clock_t)cpu_time.child_user_ns / ns;
+	buffer->tms_cstime = (clock_t)cpu_time.child_system_ns / ns;
+
+	return (clock_t)t.tv_sec * CLOCKS_PER_SEC + (clock_t)(t.tv_nsec / ns);
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023 Antti Tiihala
+ * Copyright (c) 2023, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -21,5 +21,14 @@
 
 clock_t clock(void)
 {
-	return (clock_t)(-1);
+	struct timespec t;
+	clock_t r;
+
+	if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t) != 0)
+		return (clock_t)(-1);
+
+	r = (clock_t)t.tv_sec * CLOCKS_PER_SEC;
+	r += (clock_t)(t.tv_nsec / (1000000000L / CLOCKS_PER_SEC));
+
+	return r;
 }
@@ -26,6 +26,7 @@ static pid_t ps_sess = -1;
 
 static struct {
 	pid_t ppid; pid_t pgid; pid_t sess; size_t mem;
+	struct __dancy_cpu_time cpu;
 } *pid_array_other;
 
 static int get_width(long long num, int min)
@@ -79,6 +80,12 @@ static int write_information(struct options *opt)
 				__DANCY_PROCINFO_MEMORY,
 				&pid_array_other[i].mem, sizeof(size_t));
 
+		if (!(size < 0))
+			size = __dancy_procinfo(pid,
+				__DANCY_PROCINFO_CPU_TIME,
+				&pid_array_other[i].cpu,
+				sizeof(struct __dancy_cpu_time));
+
 		if (size < 0) {
 			if (errno == ESRCH)
 				continue;
@@ -109,16 +116,17 @@ static int write_information(struct options *opt)
 	width[3] = get_width((long long)max_pid[3], 4);
 	width[4] = get_width((long long)max_mem[0], 6);
 
-	printf("%*s  %*s  %*s  %*s  %*s  %s\n",
+	printf("%*s  %*s  %*s  %*s  %*s  %8s  %s\n",
 		width[0],  "PID", width[1], "PPID",
 		width[2], "PGID", width[3], "SESS",
-		width[4],  "MEMORY", "COMMAND");
+		width[4],  "MEMORY", "TIME", "COMMAND");
 
 	for (i = 0; i < pid_array_count; i++) {
 		pid_t pid = pid_array[i];
 		const int request = __DANCY_PROCINFO_CMDLINE;
 
 		uint8_t cmd[48];
+		unsigned long long t;
 		ssize_t size;
 
 		if (ps_sess > 0 && ps_sess != pid_array_other[i].sess)
@@ -141,6 +149,12 @@ static int write_information(struct options *opt)
 			width[3], (long long)pid_array_other[i].sess,
 			width[4], (long long)pid_array_other[i].mem);
 
+		t = pid_array_other[i].cpu.user_ns;
+		t += pid_array_other[i].cpu.system_ns;
+		t /= 1000000000ull;
+
+		printf("%5llu:%02llu  ", t / 60, t % 60);
+
 		for (j = 0; j < (size_t)size; j++) {
 			int c = (int)cmd[j];
 
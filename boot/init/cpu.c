@@ -23,10 +23,13 @@ int cpu_osfxr_support;
 int cpu_nxbit_support;
 int cpu_gpage_support;
 int cpu_rdtscp_support;
+int cpu_pcid_support;
+int cpu_monitor_support;
 
 int cpu_test_features(void)
 {
 	uint32_t eax, ecx, edx, ebx;
+	uint32_t max_leaf;
 	int ret = 0;
 
 	/*
@@ -37,7 +40,7 @@ int cpu_test_features(void)
 	b_log("CPU Features\n");
 	b_log("\t%.4s%.4s%.4s\n", (char *)&ebx, (char *)&edx, (char *)&ecx);
 
-	if (eax >= 1)
+	if ((max_leaf = eax) >= 1)
 		cpu_id((eax = 1, &eax), &ecx, &edx, &ebx);
 	else
 		eax = 0, ecx = 0, edx = 0, ebx = 0, ret = 1;
@@ -60,7 +63,26 @@ int cpu_test_features(void)
 		cpu_osfxr_support = 1;
 	}
 
+	if ((ecx & (1u << 3)) != 0) {
+		b_log("\tMONITOR and MWAIT Instructions\n");
+		cpu_monitor_support = 1;
+	}
+
 #ifdef DANCY_64
+	/*
+	 * The process-context identifiers are used only if the INVPCID
+	 * instruction is also supported.
+	 */
+	if (max_leaf >= 7 && (ecx & (1u << 17)) != 0) {
+		eax = 7, ecx = 0, ebx = 0;
+		cpu_id(&eax, &ecx, &edx, &ebx);
+
+		if ((ebx & (1u << 10)) != 0) {
+			b_log("\tProcess-Context Identifiers (PCID)\n");
+			cpu_pcid_support = 1;
+		}
+	}
+
 	eax = 0x80000001, edx = 0;
 	cpu_id(&eax, &ecx, &edx, &ebx);
 
@@ -120,6 +120,8 @@ void table_init(void)
 	kernel->cpu_feature.nxbit = cpu_nxbit_support;
 	kernel->cpu_feature.gpage = cpu_gpage_support;
 	kernel->cpu_feature.rdtscp = cpu_rdtscp_support;
+	kernel->cpu_feature.pcid = cpu_pcid_support;
+	kernel->cpu_feature.monitor = cpu_monitor_support;
 
 	/*
 	 * Write the TSC frequency variable.
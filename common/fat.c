@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020 Antti Tiihala
+ * Copyright (c) 2020, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -87,6 +87,8 @@ extern void *memset(void *s, int c, size_t n);
 
 #define FAT_READY     (0x00746166)
 
+#define FAT_EXTENT_LIMIT (4096)
+
 struct fat_name {
 	char name[12];
 	char length;
@@ -94,6 +96,12 @@ struct fat_name {
 	char padding[2];
 };
 
+struct fat_extent {
+	unsigned int index;
+	unsigned int cluster;
+	unsigned int count;
+};
+
 struct fat_fd {
 	int opened;
 	unsigned int mode;
@@ -106,6 +114,11 @@ struct fat_fd {
 	unsigned int offset;
 	unsigned int cluster_idx;
 	unsigned int cluster_val;
+
+	unsigned int extent_count;
+	unsigned int extent_size;
+	unsigned int extent_clusters;
+	struct fat_extent *extents;
 };
 
 struct fat_instance {
@@ -164,6 +177,8 @@ struct fat_instance {
 
 	unsigned int maximum_file_size;
 	unsigned int last_allocated;
+
+	unsigned char *free_bitmap;
 };
 
 #define this_fat ((struct fat_instance *)(fat))
@@ -204,6 +219,7 @@ static int check_fd(void *fat, int fd, int opened)
 		size = (size_t)fd_entries * sizeof(struct fat_fd);
 		memcpy(buf, this_fat->fd, size);
 
+		free(this_fat->fd[this_fat->fd_special].extents);
 		free(this_fat->fd);
 		this_fat->fd = buf;
 
@@ -226,9 +242,134 @@ static void init_fat_fd(void *fat, int fd)
 {
 	void *fd_entry = &this_fat->fd[fd];
 
+	free(this_fat->fd[fd].extents);
 	memset(fd_entry, 0, sizeof(struct fat_fd));
 }
 
+static void release_extents(void *fat, int fd)
+{
+	struct fat_fd *fd_entry = &this_fat->fd[fd];
+
+	free(fd_entry->extents);
+
+	fd_entry->cluster_idx = 0;
+	fd_entry->cluster_val = 0;
+
+	fd_entry->extent_count = 0;
+	fd_entry->extent_size = 0;
+	fd_entry->extent_clusters = 0;
+	fd_entry->extents = NULL;
+}
+
+static void save_cluster(void *fat, int fd, unsigned int idx,
+	unsigned int cluster)
+{
+	struct fat_fd *fd_entry = &this_fat->fd[fd];
+	struct fat_extent *extent;
+
+	fd_entry->cluster_idx = idx;
+	fd_entry->cluster_val = cluster;
+
+	/*
+	 * The extents are the contiguous cluster runs of the chain, and
+	 * they are only added in order from the beginning of the chain.
+	 */
+	if (idx != fd_entry->extent_clusters)
+		return;
+
+	if (cluster < 2 || cluster >= 0x0FFFFFF8)
+		return;
+
+	if (fd_entry->extent_count != 0) {
+		extent = &fd_entry->extents[fd_entry->extent_count - 1];
+
+		if (extent->cluster + extent->count == cluster) {
+			extent->count += 1;
+			fd_entry->extent_clusters += 1;
+			return;
+		}
+	}
+
+	if (fd_entry->extent_count == fd_entry->extent_size) {
+		unsigned int new_size = fd_entry->extent_size * 2;
+		size_t size;
+
+		if (new_size == 0)
+			new_size = 8;
+
+		if (new_size > FAT_EXTENT_LIMIT)
+			return;
+
+		size = (size_t)new_size * sizeof(struct fat_extent);
+
+		if ((extent = malloc(size)) == NULL)
+			return;
+
+		if (fd_entry->extent_count != 0) {
+			size = (size_t)fd_entry->extent_count;
+			size *= sizeof(struct fat_extent);
+			memcpy(extent, fd_entry->extents, size);
+		}
+
+		free(fd_entry->extents);
+		fd_entry->extents = extent;
+		fd_entry->extent_size = new_size;
+	}
+
+	extent = &fd_entry->extents[fd_entry->extent_count++];
+
+	extent->index = idx;
+	extent->cluster = cluster;
+	extent->count = 1;
+
+	fd_entry->extent_clusters += 1;
+}
+
+static void find_cluster(void *fat, int fd, unsigned int idx,
+	unsigned int *i, unsigned int *cluster)
+{
+	struct fat_fd *fd_entry = &this_fat->fd[fd];
+	unsigned int lo = 0, hi, target = idx;
+	struct fat_extent *extent;
+
+	/*
+	 * Use the previous value if possible. This avoids going
+	 * through the whole cluster chain.
+	 */
+	if (fd_entry->cluster_idx != 0 && fd_entry->cluster_idx <= idx) {
+		*i = fd_entry->cluster_idx;
+		*cluster = fd_entry->cluster_val;
+	}
+
+	if (fd_entry->extent_count == 0)
+		return;
+
+	if (target >= fd_entry->extent_clusters)
+		target = fd_entry->extent_clusters - 1;
+
+	if (*i >= target)
+		return;
+
+	/*
+	 * Find the last extent that starts at or before the target.
+	 */
+	hi = fd_entry->extent_count - 1;
+
+	while (lo < hi) {
+		unsigned int mid = lo + (hi - lo + 1) / 2;
+
+		if (fd_entry->extents[mid].index <= target)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	extent = &fd_entry->extents[lo];
+
+	*i = target;
+	*cluster = extent->cluster + (target - extent->index);
+}
+
 static int fat_strncmp(const char *s1, const char *s2, size_t n)
 {
 	unsigned char c1, c2;
@@ -801,6 +942,112 @@ static unsigned int get_table_value(void *fat, unsigned int off)
 	return 1;
 }
 
+static void set_bitmap(void *fat, unsigned int off, unsigned int val)
+{
+	unsigned char *bitmap = this_fat->free_bitmap;
+	unsigned int bit = 1u << (off & 7);
+
+	if (bitmap == NULL)
+		return;
+
+	if (val != 0)
+		bitmap[off >> 3] = (unsigned char)(bitmap[off >> 3] | bit);
+	else
+		bitmap[off >> 3] = (unsigned char)(bitmap[off >> 3] & ~bit);
+}
+
+static int build_bitmap(void *fat)
+{
+	unsigned int clusters = this_fat->fs_clusters + 2;
+	size_t size = (size_t)(clusters / 8 + 1);
+	unsigned char *bitmap;
+	unsigned int i;
+
+	if (this_fat->free_bitmap != NULL)
+		return 0;
+
+	if ((bitmap = malloc(size)) == NULL)
+		return 1;
+
+	/*
+	 * The bits are set for the allocated clusters. The bits after
+	 * the last cluster are also set.
+	 */
+	memset(bitmap, 0xFF, size);
+
+	for (i = 2; i < clusters; i++) {
+		if (get_table_value(fat, i) == 0)
+			bitmap[i >> 3] &= (unsigned char)(~(1u << (i & 7)));
+	}
+
+	this_fat->free_bitmap = bitmap;
+
+	return 0;
+}
+
+static unsigned int find_free_run(void *fat, unsigned int start,
+	unsigned int count)
+{
+	unsigned char *bitmap = this_fat->free_bitmap;
+	unsigned int beg = start, end = this_fat->fs_clusters + 2;
+	int i;
+
+	/*
+	 * Search from the start cluster to the end, and then from the
+	 * first cluster to the start cluster.
+	 */
+	for (i = 0; i < 2; i++) {
+		unsigned int off = beg, run = 0;
+
+		while (off < end) {
+			unsigned int byte = bitmap[off >> 3];
+
+			if (run == 0 && (off & 7) == 0 && byte == 0xFF) {
+				off += 8;
+				continue;
+			}
+
+			if ((byte & (1u << (off & 7))) != 0)
+				run = 0;
+			else if (++run == count)
+				return off + 1 - count;
+
+			off += 1;
+		}
+
+		beg = 2, end = start;
+	}
+
+	return 0;
+}
+
+static void reserve_clusters(void *fat, unsigned int next, unsigned int count)
+{
+	unsigned int clusters = this_fat->fs_clusters + 2;
+	unsigned int start = this_fat->last_allocated;
+	unsigned int i;
+
+	if (count == 0 || build_bitmap(fat) != 0)
+		return;
+
+	/*
+	 * Continue the cluster chain if there are enough free clusters
+	 * after the last cluster.
+	 */
+	if (next >= 2 && next < clusters && count <= clusters - next) {
+		if (find_free_run(fat, next, count) == next) {
+			this_fat->last_allocated = next;
+			return;
+		}
+	}
+
+	if (start < 2 || start >= clusters)
+		start = 2;
+
+	if ((i = find_free_run(fat, start, count)) != 0)
+		this_fat->last_allocated = i;
+}
+
 static int set_table_value(void *fat, unsigned int off, unsigned int val)
 {
 	unsigned char *table_buffer = this_fat->table_buffer;
@@ -810,6 +1057,8 @@ static int set_table_value(void *fat, unsigned int off, unsigned int val)
 	if (off >= this_fat->fs_clusters + 2)
 		return FAT_INCONSISTENT_STATE;
 
+	set_bitmap(fat, off, val);
+
 	if (this_fat->type_12) {
 		unsigned int add = off + (off >> 1);
 		unsigned int old_val, sec;
@@ -1012,6 +1261,28 @@ static int allocate_cluster(void *fat, unsigned int *cluster)
 	unsigned int clusters = this_fat->fs_clusters + 2;
 	unsigned int i;
 
+	/*
+	 * Use the free cluster bitmap if it is available. The table
+	 * value is checked because the bitmap is updated before the
+	 * table, and the update may have failed.
+	 */
+	if (build_bitmap(fat) == 0) {
+		unsigned int start = this_fat->last_allocated;
+
+		if (start < 2 || start >= clusters)
+			start = 2;
+
+		while ((i = find_free_run(fat, start, 1)) != 0) {
+			if (get_table_value(fat, i) == 0) {
+				this_fat->last_allocated = i;
+				return *cluster = i, 0;
+			}
+			set_bitmap(fat, i, 1);
+		}
+
+		return *cluster = 0, FAT_NOT_ENOUGH_SPACE;
+	}
+
 	if (this_fat->last_allocated > 2) {
 		for (i = this_fat->last_allocated; i < clusters; i++) {
 			if (get_table_value(fat, i) == 0) {
@@ -1101,8 +1372,7 @@ static void delete_extra_clusters(void *fat, int fd)
 	cluster = (LE16(&record[20]) << 16) | LE16(&record[26]);
 	file_size = LE32(&record[28]);
 
-	this_fat->fd[fd].cluster_idx = 0;
-	this_fat->fd[fd].cluster_val = 0;
+	release_extents(fat, fd);
 
 	if (file_size == 0) {
 		W_LE16(&record[20], 0);
@@ -1872,6 +2142,7 @@ int fat_create(void **instance, int id)
 	fat->table_buffer = NULL;
 	fat->table_sectors = NULL;
 	fat->path_buffer = NULL;
+	fat->free_bitmap = NULL;
 
 	fat->fd_entries = (unsigned int)(fd_size / sizeof(struct fat_fd));
 	fat->id = id;
@@ -1928,12 +2199,23 @@ int fat_delete(void *fat)
 		write_fs_info(fat);
 	}
 
+	/*
+	 * The fd entries are valid if the special entry has been set.
+	 */
+	if (this_fat->fd_special != 0) {
+		unsigned int i;
+
+		for (i = 0; i <= this_fat->fd_special; i++)
+			free(this_fat->fd[i].extents);
+	}
+
 	free(this_fat->fd);
 	free(this_fat->block_buffer);
 	free(this_fat->cluster_buffer);
 	free(this_fat->table_buffer);
 	free(this_fat->table_sectors);
 	free(this_fat->path_buffer);
+	free(this_fat->free_bitmap);
 
 	this_fat->ready = 0;
 	free(fat);
@@ -1950,6 +2232,7 @@ int fat_close(void *fat, int fd)
 		return FAT_INVALID_PARAMETERS;
 
 	this_fat->fd[fd].opened = 0;
+	release_extents(fat, fd);
 
 	return 0;
 }
@@ -2274,24 +2557,19 @@ int fat_read(void *fat, int fd, size_t *size, void *buf)
 		file_clusters += 1;
 
 	/*
-	 * Find the first cluster to be read. Use the previous value if
-	 * possible. This avoids going through the whole cluster chain.
+	 * Find the first cluster to be read. The known extents of the
+	 * cluster chain are used if possible.
 	 */
 	{
 		unsigned int i = 0, read_index;
 
 		read_index = this_fat->fd[fd].offset / cluster_size;
-
-		if (this_fat->fd[fd].cluster_idx != 0) {
-			if (this_fat->fd[fd].cluster_idx <= read_index) {
-				i = this_fat->fd[fd].cluster_idx;
-				cluster = this_fat->fd[fd].cluster_val;
-			}
-		}
+		find_cluster(fat, fd, read_index, &i, &cluster);
 
 		r = FAT_INCONSISTENT_STATE;
 
 		for (/* void */; i < file_clusters; i++) {
+			save_cluster(fat, fd, i, cluster);
 			if (i == read_index) {
 				r = 0;
 				break;
@@ -2335,9 +2613,7 @@ int fat_read(void *fat, int fd, size_t *size, void *buf)
 			unsigned int idx = this_fat->fd[fd].offset;
 
 			idx = (idx + read_bytes) / cluster_size;
-
-			this_fat->fd[fd].cluster_idx = idx;
-			this_fat->fd[fd].cluster_val = cluster;
+			save_cluster(fat, fd, idx, cluster);
 		}
 
 		if (buf_ptr != NULL) {
@@ -2746,12 +3022,22 @@ int fat_write(void *fat, int fd, size_t *size, const void *buf)
 	}
 
 	/*
-	 * Allocate the first cluster.
+	 * Calculate how many clusters are needed.
+	 */
+	file_clusters = file_size / cluster_size;
+	if ((file_size % cluster_size) != 0)
+		file_clusters += 1;
+
+	/*
+	 * Allocate the first cluster. The file is written to a contiguous
+	 * run of free clusters if possible.
 	 */
 	if (requested_size != 0 && record_cluster == 0) {
 		const unsigned int end = 0x0FFFFFFF;
 		unsigned int cluster_hi, cluster_lo;
 
+		reserve_clusters(fat, 0, file_clusters);
+
 		if ((r = allocate_cluster(fat, &record_cluster)) != 0)
 			return r;
 		if ((r = set_table_value(fat, record_cluster, end)) != 0)
@@ -2774,13 +3060,6 @@ int fat_write(void *fat, int fd, size_t *size, const void *buf)
 		}
 	}
 
-	/*
-	 * Calculate how many clusters are needed.
-	 */
-	file_clusters = file_size / cluster_size;
-	if ((file_size % cluster_size) != 0)
-		file_clusters += 1;
-
 	/*
 	 * Find first write cluster and allocate additional clusters.
 	 */
@@ -2788,21 +3067,13 @@ int fat_write(void *fat, int fd, size_t *size, const void *buf)
 		unsigned int iterate_limit = this_fat->fs_clusters + 2;
 		unsigned int cluster = record_cluster;
 		unsigned int i = 0, next, write_index;
+		int reserved = 0;
 
 		write_index = (fd_entry->offset - seek_bytes) / cluster_size;
-
-		/*
-		 * Use the previous value if possible. This avoids
-		 * going through the whole cluster chain.
-		 */
-		if (fd_entry->cluster_idx != 0) {
-			if (fd_entry->cluster_idx <= write_index) {
-				i = fd_entry->cluster_idx;
-				cluster = fd_entry->cluster_val;
-			}
-		}
+		find_cluster(fat, fd, write_index, &i, &cluster);
 
 		for (/* void */; i < iterate_limit; i++) {
+			save_cluster(fat, fd, i, cluster);
 			if (i == write_index) {
 				offset_cluster = cluster;
 				if (file_size == original_file_size)
@@ -2815,6 +3086,13 @@ int fat_write(void *fat, int fd, size_t *size, const void *buf)
 				if (i + 1 >= file_clusters)
 					break;
 
+				if (!reserved) {
+					unsigned int n = file_clusters - i - 1;
+
+					reserve_clusters(fat, cluster + 1, n);
+					reserved = 1;
+				}
+
 				r = append_cluster(fat, cluster, 1);
 				if (r != 0)
 					break;
@@ -2845,8 +3123,9 @@ int fat_write(void *fat, int fd, size_t *size, const void *buf)
 		const unsigned char *buf_ptr = buf;
 		unsigned int original_size = LE32(&record[28]);
 		unsigned char *cluster_buffer = this_fat->cluster_buffer;
-		unsigned int end, offset, written = 0;
+		unsigned int end, idx, offset, written = 0;
 
+		idx = (fd_entry->offset - seek_bytes) / cluster_size;
 		offset = (fd_entry->offset - seek_bytes) % cluster_size;
 
 		if (requested_size > this_fat->maximum_file_size)
@@ -2867,16 +3146,11 @@ int fat_write(void *fat, int fd, size_t *size, const void *buf)
 				break;
 
 			/*
-			 * Save known cluster index and value.
+			 * Save known cluster index and value. The index
+			 * is not computed from the offset because of the
+			 * seek bytes.
 			 */
-			{
-				unsigned int idx = this_fat->fd[fd].offset;
-
-				idx = (idx + written_bytes) / cluster_size;
-
-				this_fat->fd[fd].cluster_idx = idx;
-				this_fat->fd[fd].cluster_val = offset_cluster;
-			}
+			save_cluster(fat, fd, idx++, offset_cluster);
 
 			if (seek_bytes != 0) {
 				while (offset < cluster_size) {
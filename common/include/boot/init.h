@@ -127,6 +127,8 @@ extern int cpu_osfxr_support;
 extern int cpu_nxbit_support;
 extern int cpu_gpage_support;
 extern int cpu_rdtscp_support;
+extern int cpu_pcid_support;
+extern int cpu_monitor_support;
 
 int cpu_test_features(void);
 void cpu_init_control_registers(void);
@@ -30,8 +30,12 @@
 void apic_eoi(void);
 uint32_t apic_id(void);
 void apic_send(uint32_t icr_low, uint32_t icr_high);
+void apic_send_ipi(uint32_t id, uint32_t vector);
 int apic_wait_delivery(void);
 
+uint32_t apic_read(uint32_t offset);
+void apic_write(uint32_t offset, uint32_t value);
+
 void ioapic_disable(int irq);
 void ioapic_enable(int irq);
 uint64_t ioapic_redtbl(int irq);
@@ -67,6 +71,11 @@ void event_signal(event_t event);
 int event_wait(event_t event, uint16_t milliseconds);
 int event_wait_array(int count, event_t *events, uint16_t milliseconds);
 
+struct waitq_entry;
+
+void event_watch(event_t event, struct waitq_entry *entry);
+void event_unwatch(event_t event, struct waitq_entry *entry);
+
 void event_yield(void);
 
 /*
@@ -97,6 +106,15 @@ enum gdt_sys_sel {
 	gdt_sysret_sel  = 0x18
 };
 
+struct gdt_data {
+	int cpu;
+	uint32_t apic_id;
+	void *sched;
+
+	uint64_t interrupts;
+	uint64_t switches;
+};
+
 int gdt_init(void);
 int gdt_init_ap(void);
 
@@ -108,6 +126,8 @@ void gdt_load_ds(int sel);
 void gdt_load_fs(int sel);
 void gdt_load_gs(int sel);
 
+int gdt_get_cpu(void);
+struct gdt_data *gdt_get_data(void);
 void *gdt_get_tss(void);
 void gdt_load_tss(int sel);
 uint32_t gdt_read_segment(int sel, size_t offset);
@@ -115,8 +135,19 @@ uint32_t gdt_read_segment(int sel, size_t offset);
 /*
  * Declarations of heap.c
  */
+struct heap_cache_stat {
+	size_t object_size;
+	size_t slab_count;
+	size_t object_count;
+	size_t free_count;
+	size_t magazine_count;
+};
+
 int heap_init(void);
+int heap_init_cpu(void);
+int heap_init_blocks(void);
 void heap_usage(size_t *allocated, size_t *unallocated);
+int heap_cache_stat(int cache, struct heap_cache_stat *stat);
 void *heap_alloc_static_page(void);
 
 /*
@@ -186,6 +217,9 @@ phys_addr_t mm_alloc_pages(int type, int order);
 void mm_free_page(phys_addr_t addr);
 void mm_free_pages(phys_addr_t addr, int order);
 
+phys_addr_t mm_alloc_zero_page(void);
+void mm_zero_pages(void);
+
 /*
  * Declarations of mtx.c
  */
@@ -228,7 +262,10 @@ enum pg_type {
 	pg_blocked  = 0x0100,
 	pg_readonly = 0x0200,
 	pg_noexec   = 0x0400,
-	pg_arctic   = 0x0800
+	pg_arctic   = 0x0800,
+	pg_lazy     = 0x1000,
+	pg_shared   = 0x2000,
+	pg_large    = 0x4000
 };
 
 extern cpu_native_t pg_kernel;
@@ -243,6 +280,9 @@ void pg_sync_arctic(void);
 void pg_enter_kernel(void);
 void pg_leave_kernel(void);
 
+void pg_switch_user(struct task *next);
+void pg_invalidate_page(const void *vaddr);
+
 int pg_alt_create(void);
 void pg_alt_accept(void);
 void pg_alt_delete(void);
@@ -252,16 +292,34 @@ void *pg_map_kernel(phys_addr_t addr, size_t size, int type);
 void *pg_map_user(addr_t vaddr, size_t size, int type);
 int pg_unmap_user(addr_t vaddr, size_t size);
 
+void *pg_map_shared(addr_t vaddr, size_t size,
+	const phys_addr_t *pages, int type);
+int pg_share_user(addr_t vaddr, size_t size, phys_addr_t *pages);
+
 uint64_t pg_read_memory(phys_addr_t addr, size_t size);
 void pg_write_memory(phys_addr_t addr, uint64_t val, size_t size);
 
-void pg_protect_user(addr_t vaddr, size_t size, int type);
+int pg_protect_user(addr_t vaddr, size_t size, int type);
+int pg_fault_user(addr_t vaddr);
 
 int pg_check_user_read(const void *vaddr, size_t size);
 int pg_check_user_write(void *vaddr, size_t size);
 int pg_check_user_string(const void *vaddr, int *count);
 int pg_check_user_vector(const void *vaddr, int *count);
 
+/*
+ * Declarations of pg_file.c
+ */
+struct pg_file_map;
+struct vfs_node;
+
+int pg_file_map(addr_t vaddr, size_t size,
+	struct vfs_node *node, uint64_t offset, int type, int shared);
+int pg_file_unmap(addr_t vaddr, size_t size);
+int pg_file_sync(addr_t vaddr, size_t size);
+int pg_file_fill(addr_t vaddr, void *page);
+void pg_file_release(struct pg_file_map **maps, cpu_native_t cr3);
+
 /*
  * Declarations of ret_user.c
  */
@@ -288,7 +346,7 @@ void kernel_start(void);
 void kernel_start_ap(void);
 
 /*
- * Declarations of timer.asm
+ * Declarations of timer.asm and timer.c
  */
 extern uint8_t timer_apic_base[];
 extern const uint8_t timer_asm_handler_apic[];
@@ -300,4 +358,35 @@ extern volatile uint32_t timer_fault_count;
 
 uint64_t timer_read(void);
 
+int timer_init(void);
+uint64_t timer_read_ns(void);
+
+int timer_arm(struct timer *t, uint64_t deadline,
+	void (*func)(void *arg), void *arg);
+int timer_cancel(struct timer *t);
+void timer_expire(void);
+
+/*
+ * Declarations of waitq.c
+ */
+struct waitq_entry {
+	struct waitq_entry *next;
+	struct waitq_entry *prev;
+	struct task *task;
+	int linked;
+};
+
+struct waitq {
+	int lock;
+	struct waitq_entry *head;
+	struct waitq_entry *tail;
+};
+
+void waitq_init(struct waitq *wq);
+void waitq_add(struct waitq *wq, struct waitq_entry *entry);
+void waitq_remove(struct waitq *wq, struct waitq_entry *entry);
+
+struct task *waitq_wake_one(struct waitq *wq);
+struct task *waitq_wake_all(struct waitq *wq);
+
 #endif
@@ -31,8 +31,11 @@ int bin_init(void);
 /*
  * Declarations of coff.c
  */
+struct coff_image;
+
 extern const unsigned int coff_native_signature;
 int coff_load_executable(struct vfs_node *node, addr_t *start_addr);
+void coff_release_image(struct coff_image *image);
 
 /*
  * Declarations of console.c
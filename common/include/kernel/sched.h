@@ -22,6 +22,8 @@
 
 #include <misc/types.h>
 
+struct task;
+
 enum sched_priority {
 	sched_priority_kernel = 0, /* default */
 	sched_priority_high,
@@ -29,9 +31,24 @@ enum sched_priority {
 	sched_priority_low
 };
 
+/*
+ * The real-time policies use the numeric priorities (1 - 99). Their
+ * run queue level is between the kernel and high priority levels. The
+ * values are the same as the __DANCY_SCHED_* values.
+ */
+enum sched_policy {
+	sched_policy_other = 0,
+	sched_policy_fifo,
+	sched_policy_rr
+};
+
+#define SCHED_RT_PRIORITY_MIN (1)
+#define SCHED_RT_PRIORITY_MAX (99)
+
 /*
  * Declarations of sched.c
  */
 int sched_init(void);
+int sched_set_policy(struct task *task, int policy, int priority);
 
 #endif
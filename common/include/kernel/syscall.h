@@ -68,6 +68,8 @@ int file_getdents(int fd, void *buffer, size_t size, int *count, int flags);
 int file_realpath(const char *name, void *buffer, size_t size);
 int file_poll(struct pollfd fds[], int nfds, int timeout, int *retval);
 int file_ioctl(int fd, int request, long long arg);
+int file_mmap(int fd, addr_t vaddr, size_t size,
+	uint64_t offset, int type, int shared);
 
 int file_openpty(int fd[2], char name[16],
 	const struct __dancy_termios *termios_p,
@@ -88,6 +90,7 @@ int kill_internal(__dancy_pid_t pid, int sig, int flags);
  */
 int getpgid_internal(uint64_t id, uint64_t *id_group);
 int getsid_internal(uint64_t id, uint64_t *id_session);
+int setaffinity_internal(uint64_t id, uint64_t mask);
 
 /*
  * Declarations of proc.c
@@ -22,6 +22,8 @@
 
 #include <misc/types.h>
 
+struct task;
+
 struct kernel_table {
 	size_t table_size;
 
@@ -136,6 +138,8 @@ struct kernel_table {
 		int nxbit;
 		int gpage;
 		int rdtscp;
+		int pcid;
+		int monitor;
 	} cpu_feature;
 
 	/*
@@ -227,6 +231,8 @@ struct kernel_table {
 	 */
 	struct {
 		void (*yield)(void);
+		void (*enqueue)(struct task *task);
+		void (*preempt)(void);
 
 		int *task_lock;
 		void *task_head;
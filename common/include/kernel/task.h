@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021, 2022, 2023, 2024, 2025 Antti Tiihala
+ * Copyright (c) 2021, 2022, 2023, 2024, 2025, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -28,6 +28,26 @@ enum task_type {
 	task_uniproc  = 0x02
 };
 
+enum task_block_state {
+	task_block_none    = 0x00,
+	task_block_wakeup  = 0x01,
+	task_block_timeout = 0x02
+};
+
+/*
+ * The one-shot timers are defined here, because each task has one
+ * for its blocking functions (see timer.c).
+ */
+struct timer {
+	uint64_t deadline;
+	void (*func)(void *arg);
+	void *arg;
+	int index;
+};
+
+struct coff_image;
+struct pg_file_map;
+
 #define TASK_CMD_STATIC_SIZE 32
 #define TASK_FD_STATIC_COUNT 64
 
@@ -39,12 +59,14 @@ struct task {
 	int asm_data2;      /* Offset: 16 + 2 * sizeof(int) */
 	int asm_data3;      /* Offset: 16 + 3 * sizeof(int) */
 	addr_t next;        /* Offset: 16 + 4 * sizeof(int) */
+	int fstate_loaded;  /* Offset: 16 + 4 * sizeof(int) + sizeof(addr_t) */
 
 	uint64_t id;
 	uint64_t id_owner;
 	uint64_t id_group;
 	uint64_t id_session;
 	struct task *owner;
+	struct task *index_next[3];
 
 	int detached;
 	int retval;
@@ -68,14 +90,38 @@ struct task {
 	uint32_t pg_cr3;
 	uint32_t pg_alt_cr3;
 	uint32_t pg_state;
+	uint32_t pg_generation;
 	cpu_native_t pg_user_memory;
+	struct coff_image *pg_image;
+	struct coff_image *pg_alt_image;
+	struct pg_file_map *pg_maps;
+	struct pg_file_map *pg_alt_maps;
 
 	struct {
 		int lock;
 		int priority;
-		uint32_t state;
+		int queued;
+		int cpu;
+		int blocked;
+		struct task *next;
+		uint64_t affinity;
+		int policy;
+		int rt_priority;
 	} sched;
 
+	struct timer timer;
+
+	struct {
+		uint64_t tsc;
+		uint64_t user;
+		uint64_t system;
+		uint64_t child_user;
+		uint64_t child_system;
+		uint32_t switches;
+		uint32_t wakeups;
+		int user_mode;
+	} cpu;
+
 	struct {
 		uint8_t *line;
 		uint8_t _line[TASK_CMD_STATIC_SIZE];
@@ -101,6 +147,7 @@ extern void *task_uniproc_tss;
 
 struct task *task_read_next(const struct task *task);
 struct task *task_write_next(struct task *task, struct task *next);
+void task_restore_fstate(void);
 
 int task_init(void);
 int task_init_ap(void);
@@ -111,6 +158,14 @@ struct task *task_find(uint64_t id);
 uint64_t task_create(int (*func)(void *), void *arg, int type);
 void task_access(void (*func)(struct task *, void *), void *arg);
 void task_foreach(int (*func)(struct task *, void *), void *arg);
+
+void task_foreach_id(uint64_t id,
+	int (*func)(struct task *, void *), void *arg);
+void task_foreach_group(uint64_t id_group,
+	int (*func)(struct task *, void *), void *arg);
+void task_foreach_session(uint64_t id_session,
+	int (*func)(struct task *, void *), void *arg);
+void task_set_group(struct task *task, uint64_t id_group, uint64_t id_session);
 void task_set_cmdline(struct task *task, void *line, const char *cline);
 void task_prepare_rebooting(void);
 int task_signaled(struct task *task);
@@ -118,14 +173,24 @@ int task_signaled(struct task *task);
 void task_identify(uint64_t *id, uint64_t *id_owner,
 	uint64_t *id_group, uint64_t *id_session);
 
+void task_account_mode(int user_mode);
+void task_read_cpu_time(struct task *task, uint64_t *user_ns,
+	uint64_t *system_ns, uint64_t *child_ns);
+
 int task_check_event(struct task *task);
 int task_read_event(void);
 void task_write_event(int (*func)(uint64_t *data), uint64_t d0, uint64_t d1);
 
+void task_block_prepare(uint64_t deadline);
+int task_block(void);
+void task_block_cancel(void);
+void task_wakeup(struct task *task);
+
 void task_idle(void);
 void task_exit(int retval);
 void task_jump(addr_t user_ip, addr_t user_sp);
 void task_sleep(uint64_t milliseconds);
+void task_sleep_ns(uint64_t nanoseconds);
 
 int task_switch(struct task *next);
 void task_switch_disable(void);
@@ -61,6 +61,9 @@ struct vfs_node {
 	unsigned int tree_state;
 	unsigned int mount_state;
 
+	struct vfs_node *dentry_next;
+	int dentry_negative;
+
 	void *internal_data;
 	event_t *internal_event;
 
@@ -111,6 +114,28 @@ struct vfs_stat {
 	size_t block_size;
 };
 
+/*
+ * Declarations of bcache.c
+ */
+#define BCACHE_DEVICES (64)
+
+struct bcache_stat {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t blocks;
+	uint64_t block_size;
+};
+
+int bcache_init(void);
+
+int bcache_read(int device, struct vfs_node *node, size_t block_size,
+	uint64_t lba, size_t *size, void *buffer);
+int bcache_write(int device, struct vfs_node *node, size_t block_size,
+	uint64_t lba, size_t *size, const void *buffer);
+
+void bcache_invalidate(int device);
+int bcache_stat(int device, struct bcache_stat *stat);
+
 /*
  * Declarations of default.c
  */
@@ -149,6 +174,7 @@ int vfs_init_root(struct vfs_node **node);
  */
 int vfs_init(void);
 void vfs_init_node(struct vfs_node *node, size_t size);
+void vfs_dentry_invalidate(void);
 
 void vfs_lock_tree(void);
 void vfs_unlock_tree(void);
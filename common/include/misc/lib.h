@@ -51,9 +51,12 @@ void coff_relocate(void *base, void *reloc, void *symbol);
  */
 void cpu_id(uint32_t *a, uint32_t *c, uint32_t *d, uint32_t *b);
 void cpu_halt(uint32_t counter);
+void cpu_idle(void);
+void cpu_idle_monitor(const void *address, uint32_t value);
 
 int cpu_ints(int enable);
 void cpu_invlpg(const void *address);
+void cpu_invpcid(cpu_native_t type, const void *descriptor);
 void cpu_wbinvd(void);
 
 void cpu_rdtsc(uint32_t *a, uint32_t *d);
@@ -101,6 +104,7 @@ void cpu_write_cr3(cpu_native_t value);
 void cpu_write_cr4(cpu_native_t value);
 
 cpu_native_t cpu_xchg(cpu_native_t *address, cpu_native_t value);
+void cpu_zero_page(void *address);
 
 /*
  * Declarations of crc32.c and crc32c.c
@@ -29,6 +29,7 @@ section .text
         global _task_switch_disable
         global _task_switch_enable
         global _task_read_next
+        global _task_restore_fstate
         global _task_write_next
         global _task_patch_fxsave
         global _task_patch_fxrstor
@@ -45,6 +46,9 @@ align 16
         ;         int asm_data2;   /* Offset: 16 + 2 * sizeof(int) */
         ;         int asm_data3;   /* Offset: 16 + 3 * sizeof(int) */
         ;         addr_t next;     /* Offset: 16 + 4 * sizeof(int) */
+        ;         int fstate_loaded;
+        ;                          /* Offset: 16 + 4 * sizeof(int)
+        ;                             + sizeof(addr_t) */
         ;         ...
         ; };
 _task_create_asm:
@@ -141,21 +145,24 @@ _task_switch_asm_esp0:
         lea ebx, [ecx+0x1FF0]           ; ebx = value of esp0
         mov [edx+4], ebx                ; update esp0 (task-state segment)
 
-        lea ebx, [eax+0x0400]           ; ebx = address of fxsave area
         mov [eax], esp                  ; save stack pointer
+        cmp dword [eax+36], 0           ; check if the fpu state is loaded
+        je short _task_switch_asm_next
+
+        lea ebx, [eax+0x0400]           ; ebx = address of fxsave area
 
         ; uint8_t task_patch_fxsave[3]
 _task_patch_fxsave:
         db 0x0F, 0xAE, 0x03             ; "fxsave [ebx]"
 
+        mov dword [eax+36], 0           ; clear fstate_loaded
+        mov ebx, cr0                    ; ebx = cr0
+        or ebx, 8                       ; set task switched bit
+        mov cr0, ebx                    ; (next fpu instruction raises #NM)
+
+_task_switch_asm_next:
         mov esp, [ecx]                  ; esp = next->sp
         mov edx, [ecx+8]                ; edx = next->cr3
-        lea ebx, [ecx+0x0400]           ; ebx = address of fxrstor area
-
-        ; uint8_t task_patch_fxrstor[3]
-_task_patch_fxrstor:
-        db 0x0F, 0xAE, 0x0B             ; "fxrstor [ebx]"
-
         mov cr3, edx                    ; change virtual address space
         mov dword [eax+16], 0           ; clear active flag (previous task)
 
@@ -198,6 +205,23 @@ _state_error:
 .L1:    hlt                             ; halt instruction
         jmp short .L1
 
+align 16
+        ; void task_restore_fstate(void)
+_task_restore_fstate:
+        push ebx                        ; save register ebx
+        mov eax, esp                    ; eax = stack pointer
+        and eax, 0xFFFFE000             ; eax = address of current task
+        clts                            ; clear task switched bit
+        lea ebx, [eax+0x0400]           ; ebx = address of fxrstor area
+
+        ; uint8_t task_patch_fxrstor[3]
+_task_patch_fxrstor:
+        db 0x0F, 0xAE, 0x0B             ; "fxrstor [ebx]"
+
+        mov dword [eax+36], 1           ; set fstate_loaded
+        pop ebx                         ; restore register ebx
+        ret
+
 align 16
         ; struct task *task_read_next(const struct task *task)
 _task_read_next:
@@ -29,6 +29,7 @@ section .text
         global task_switch_disable
         global task_switch_enable
         global task_read_next
+        global task_restore_fstate
         global task_write_next
 
 align 16
@@ -43,6 +44,9 @@ align 16
         ;         int asm_data2;   /* Offset: 16 + 2 * sizeof(int) */
         ;         int asm_data3;   /* Offset: 16 + 3 * sizeof(int) */
         ;         addr_t next;     /* Offset: 16 + 4 * sizeof(int) */
+        ;         int fstate_loaded;
+        ;                          /* Offset: 16 + 4 * sizeof(int)
+        ;                             + sizeof(addr_t) */
         ;         ...
         ; };
 task_create_asm:
@@ -147,12 +151,18 @@ task_switch_asm_rsp0:
         mov [rdx+4], rbx                ; update rsp0 (task-state segment)
 
         mov [rax], rsp                  ; save stack pointer
+        cmp dword [rax+40], 0           ; check if the fpu state is loaded
+        je short task_switch_asm_next
+
         fxsave [rax+0x0400]             ; save fpu, mmx, and sse state
+        mov dword [rax+40], 0           ; clear fstate_loaded
+        mov rbx, cr0                    ; rbx = cr0
+        or ebx, 8                       ; set task switched bit
+        mov cr0, rbx                    ; (next fpu instruction raises #NM)
 
+task_switch_asm_next:
         mov rsp, [rcx]                  ; rsp = next->sp
         mov rdx, [rcx+8]                ; rdx = next->cr3
-        fxrstor [rcx+0x0400]            ; restore fpu, mmx, and sse state
-
         mov cr3, rdx                    ; change virtual address space
         mov dword [rax+16], 0           ; clear active flag (previous task)
 
@@ -204,6 +214,16 @@ state_error:
 .L1:    hlt                             ; halt instruction
         jmp short .L1
 
+align 16
+        ; void task_restore_fstate(void)
+task_restore_fstate:
+        mov rax, rsp                    ; rax = stack pointer
+        and rax, -8192                  ; rax = address of current task
+        clts                            ; clear task switched bit
+        fxrstor [rax+0x0400]            ; restore fpu, mmx, and sse state
+        mov dword [rax+40], 1           ; set fstate_loaded
+        ret
+
 align 16
         ; struct task *task_read_next(const struct task *task)
 task_read_next:
@@ -58,6 +58,23 @@ void apic_send(uint32_t icr_low, uint32_t icr_high)
 	cpu_write32(icr_300, icr_low);
 }
 
+void apic_send_ipi(uint32_t id, uint32_t vector)
+{
+	/*
+	 * Fixed delivery mode, physical destination, and assert level.
+	 */
+	uint32_t icr_low = 0x00004000 | (vector & 0xFF);
+	uint32_t icr_high = id << 24;
+	int r;
+
+	if (!kernel->apic_enabled || id > 0xFE)
+		return;
+
+	r = cpu_ints(0);
+	apic_send(icr_low, icr_high);
+	cpu_ints(r);
+}
+
 int apic_wait_delivery(void)
 {
 	const void *icr_300 = (const void *)(kernel->apic_base_vaddr + 0x300);
@@ -75,6 +92,20 @@ int apic_wait_delivery(void)
 	return 1;
 }
 
+uint32_t apic_read(uint32_t offset)
+{
+	const void *r = (const void *)(kernel->apic_base_vaddr + offset);
+
+	return cpu_read32(r);
+}
+
+void apic_write(uint32_t offset, uint32_t value)
+{
+	void *r = (void *)(kernel->apic_base_vaddr + offset);
+
+	cpu_write32(r, value);
+}
+
 static int ioapic_lock;
 
 static void ioapic_access(int irq, int interrupt_mask, uint64_t *redtbl)
@@ -24,7 +24,7 @@ struct event_instance {
 	int lock;
 	int manual_reset;
 	int signaled;
-	cpu_native_t task;
+	struct waitq waitq;
 };
 
 #define EVENT_READY (0x00657665)
@@ -43,6 +43,7 @@ event_t event_create(int type)
 		memset(event, 0, size);
 
 		this_event->ready = EVENT_READY;
+		waitq_init(&this_event->waitq);
 
 		if ((type & event_type_manual_reset) != 0)
 			this_event->manual_reset = 1;
@@ -79,7 +80,7 @@ void event_reset(event_t event)
 
 void event_signal(event_t event)
 {
-	cpu_native_t task = 0;
+	struct task *task;
 	void *lock_local;
 
 	if (null_event || this_event->ready != EVENT_READY)
@@ -88,12 +89,15 @@ void event_signal(event_t event)
 	lock_local = &this_event->lock;
 
 	spin_enter(&lock_local);
-
 	this_event->signaled = 1;
-	task = cpu_xchg(&this_event->task, task);
-	cpu_xchg(&yield_task, task);
-
 	spin_leave(&lock_local);
+
+	/*
+	 * Move the waiting tasks back to the run queues. The first one
+	 * of them may also be run immediately (event_yield).
+	 */
+	if ((task = waitq_wake_all(&this_event->waitq)) != NULL)
+		cpu_xchg(&yield_task, (cpu_native_t)task);
 }
 
 int event_wait(event_t event, uint16_t milliseconds)
@@ -103,46 +107,18 @@ int event_wait(event_t event, uint16_t milliseconds)
 	return event_wait_array(1, &events[0], milliseconds);
 }
 
-struct event_wait_array_data {
-	int count;
-	event_t *events;
-	uint32_t ticks[2];
-};
-
-static int event_wait_array_func(uint64_t *data)
-{
-	struct event_wait_array_data *d = (void *)((cpu_native_t)data[0]);
-	int i;
-
-	for (i = 0; i < d->count; i++) {
-		event_t event = d->events[i];
-
-		if (this_event->signaled == 1)
-			return 0;
-	}
-
-	if (d->ticks[1] != 0xFFFF) {
-		if ((timer_ticks - d->ticks[0]) >= d->ticks[1])
-			return 0;
-	}
-
-	return 1;
-}
+#define EVENT_STATIC_ENTRIES 4
 
 int event_wait_array(int count, event_t *events, uint16_t milliseconds)
 {
-	cpu_native_t task = (cpu_native_t)task_current();
-	struct event_wait_array_data data;
+	struct waitq_entry static_entries[EVENT_STATIC_ENTRIES];
+	struct waitq_entry *entries = &static_entries[0];
+	uint64_t deadline = 0;
 	int i, r = -1;
 
 	if (count <= 0 || count > 256)
 		return -2;
 
-	data.count = count;
-	data.events = events;
-	data.ticks[0] = timer_ticks;
-	data.ticks[1] = milliseconds;
-
 	for (i = 0; i < count; i++) {
 		event_t event = events[i];
 
@@ -150,8 +126,35 @@ int event_wait_array(int count, event_t *events, uint16_t milliseconds)
 			return -3;
 	}
 
+	if (milliseconds != 0xFFFF)
+		deadline = timer_read_ns() + (uint64_t)milliseconds * 1000000;
+
+	if (count > EVENT_STATIC_ENTRIES) {
+		size_t size = (size_t)count * sizeof(*entries);
+		entries = malloc(size);
+	}
+
 	for (;;) {
-		uint64_t data0, data1;
+		uint64_t block_deadline = deadline;
+		int expired;
+
+		/*
+		 * If there are no wait queue entries, the events are
+		 * polled every 10 milliseconds.
+		 */
+		if (entries == NULL) {
+			uint64_t poll_deadline = timer_read_ns() + 10000000;
+
+			if (!deadline || deadline > poll_deadline)
+				block_deadline = poll_deadline;
+		}
+
+		task_block_prepare(block_deadline);
+
+		for (i = 0; i < count && entries != NULL; i++) {
+			event_t event = events[i];
+			waitq_add(&this_event->waitq, &entries[i]);
+		}
 
 		for (i = 0; i < count && r < 0; i++) {
 			event_t event = events[i];
@@ -165,30 +168,53 @@ int event_wait_array(int count, event_t *events, uint16_t milliseconds)
 				r = (int)i;
 			}
 
-			cpu_xchg(&this_event->task, task);
 			spin_leave(&lock_local);
 		}
 
-		if (r >= 0 || milliseconds == 0)
-			break;
-
-		if (milliseconds != 0xFFFF) {
-			if ((timer_ticks - data.ticks[0]) >= data.ticks[1])
-				break;
-		}
+		expired = (deadline != 0 && timer_read_ns() >= deadline);
 
-		data0 = (uint64_t)((addr_t)&data), data1 = 0;
+		if (r < 0 && milliseconds != 0 && !expired)
+			task_block();
+		else
+			task_block_cancel();
 
-		task_write_event(event_wait_array_func, data0, data1);
+		for (i = 0; i < count && entries != NULL; i++) {
+			event_t event = events[i];
+			waitq_remove(&this_event->waitq, &entries[i]);
+		}
 
-		do {
-			task_yield();
-		} while (task_read_event());
+		if (r >= 0 || milliseconds == 0 || expired)
+			break;
 	}
 
+	if (entries != &static_entries[0])
+		free(entries);
+
 	return r;
 }
 
+void event_watch(event_t event, struct waitq_entry *entry)
+{
+	/*
+	 * The task is woken up when the event is signaled, but the
+	 * signaled state is not consumed (see file_poll).
+	 */
+	entry->linked = 0;
+
+	if (null_event || this_event->ready != EVENT_READY)
+		return;
+
+	waitq_add(&this_event->waitq, entry);
+}
+
+void event_unwatch(event_t event, struct waitq_entry *entry)
+{
+	if (null_event || this_event->ready != EVENT_READY)
+		return;
+
+	waitq_remove(&this_event->waitq, entry);
+}
+
 void event_yield(void)
 {
 	cpu_native_t task = 0;
@@ -199,6 +225,11 @@ void event_yield(void)
 		if ((struct task *)task == task_current())
 			return;
 
+		/*
+		 * The interrupted task must stay on the run queue.
+		 */
+		kernel->scheduler.enqueue(task_current());
+
 		if (!task_switch((struct task *)task))
 			return;
 
@@ -563,7 +563,7 @@ void fb_leave(void)
 			addr_t addr = (addr_t)(val & 0xFFFFF000);
 
 			*p = val & (~d_bit);
-			cpu_invlpg((const void *)addr);
+			pg_invalidate_page((const void *)addr);
 			fb_blit(i);
 		}
 	}
@@ -30,13 +30,18 @@ struct gdt_block {
 
 	uint32_t id;
 	uint32_t tss_addr;
-	uint32_t pad2[2];
+	uint32_t cpu;
+	uint32_t data_addr;
 
 	uint8_t table[80];
 	uint8_t tss[144];
+
+	uint8_t data[256];
 };
 
 static size_t tss_addr_offset = 0;
+static size_t cpu_offset = 0;
+static size_t data_addr_offset = 0;
 
 static struct gdt_block *gdt_array = NULL;
 static int gdt_count = 0;
@@ -58,6 +63,16 @@ static uint32_t gdt_early_apic_id(void)
 	return (cpu_read32(id) >> 24);
 }
 
+static void gdt_build_data(struct gdt_block *gb)
+{
+	struct gdt_data *data = (struct gdt_data *)((void *)&gb->data[0]);
+
+	gb->data_addr = (uint32_t)((addr_t)data);
+
+	data->cpu = (int)gb->cpu;
+	data->apic_id = gb->id;
+}
+
 #ifdef DANCY_32
 
 static void gdt_build_block(struct gdt_block *gb)
@@ -67,6 +82,8 @@ static void gdt_build_block(struct gdt_block *gb)
 	gb->table_limit = (uint16_t)(sizeof(gb->table) - 1);
 	gb->table_addr = (uint32_t)((addr_t)&gb->table[0]);
 	gb->id = gdt_early_apic_id();
+	gb->cpu = (uint32_t)(gb - gdt_array);
+	gdt_build_data(gb);
 
 	p = &gb->table[gdt_kernel_code];
 	p[0] = 0xFF, p[1] = 0xFF, p[2] = 0x00, p[3] = 0x00;
@@ -131,6 +148,8 @@ static void gdt_build_block(struct gdt_block *gb)
 	gb->table_limit = (uint16_t)(sizeof(gb->table) - 1);
 	gb->table_addr = (uint32_t)((addr_t)&gb->table[0]);
 	gb->id = gdt_early_apic_id();
+	gb->cpu = (uint32_t)(gb - gdt_array);
+	gdt_build_data(gb);
 
 	p = &gb->table[gdt_kernel_code];
 	p[0] = 0xFF, p[1] = 0xFF, p[2] = 0x00, p[3] = 0x00;
@@ -194,6 +213,9 @@ int gdt_init(void)
 	if (!spin_trylock(&run_once))
 		return DE_UNEXPECTED;
 
+	if (sizeof(struct gdt_data) > sizeof(gdt_array[0].data))
+		return DE_UNEXPECTED;
+
 	if (kernel->apic_bsp_id != gdt_early_apic_id())
 		return DE_UNEXPECTED;
 
@@ -216,6 +238,12 @@ int gdt_init(void)
 		a1 = (addr_t)((const unsigned char *)&gdt_array[0].tss_addr);
 
 		tss_addr_offset = (size_t)(a1 - a0);
+
+		a1 = (addr_t)((const unsigned char *)&gdt_array[0].cpu);
+		cpu_offset = (size_t)(a1 - a0);
+
+		a1 = (addr_t)((const unsigned char *)&gdt_array[0].data_addr);
+		data_addr_offset = (size_t)(a1 - a0);
 	}
 
 	gb = &gdt_array[gdt_used++];
@@ -303,3 +331,31 @@ void *gdt_get_tss(void)
 
 	return (void *)((addr_t)tss);
 }
+
+int gdt_get_cpu(void)
+{
+	uint32_t cpu;
+
+	/*
+	 * The bootstrap processor is always zero and the application
+	 * processors are numbered in the order they were initialized.
+	 * The same rules apply as with the gdt_get_tss function.
+	 */
+	cpu = gdt_read_segment(gdt_block_data, cpu_offset);
+
+	return (int)cpu;
+}
+
+struct gdt_data *gdt_get_data(void)
+{
+	uint32_t data;
+
+	/*
+	 * The per-processor data can be used without locks because only
+	 * the processor itself modifies it. The same rules apply as with
+	 * the gdt_get_tss function.
+	 */
+	data = gdt_read_segment(gdt_block_data, data_addr_offset);
+
+	return (struct gdt_data *)((addr_t)data);
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021 Antti Tiihala
+ * Copyright (c) 2021, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -26,10 +26,84 @@ static size_t heap_map_size;
 
 static int heap_map_entries;
 
+/*
+ * The small allocations are served from the slab caches. Each slab is
+ * a page that has been allocated from the heap map, and it starts with
+ * the slab header. The freed objects are first put on the per-CPU
+ * magazines, so most of the calls do not use the cache locks at all.
+ */
+#define HEAP_CACHE_COUNT 10
+#define HEAP_CACHE_MAX_SIZE 512
+#define HEAP_MAGAZINE_SIZE 16
+#define HEAP_SLAB_HEADER 64
+
+struct heap_slab {
+	struct heap_slab *next;
+	struct heap_slab *prev;
+	struct heap_cache *cache;
+	void *free_list;
+	int used;
+	int total;
+};
+
+struct heap_cache {
+	int lock;
+	int object_size;
+	int slab_objects;
+	int empty_slabs;
+	size_t slab_count;
+	size_t free_count;
+	struct heap_slab *slabs;
+};
+
+struct heap_magazine {
+	int lock;
+	int count;
+	void *objects[HEAP_MAGAZINE_SIZE];
+};
+
+static const int heap_cache_sizes[HEAP_CACHE_COUNT] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512
+};
+
+static struct heap_cache heap_caches[HEAP_CACHE_COUNT];
+static unsigned char heap_cache_index[HEAP_CACHE_MAX_SIZE / 16 + 1];
+
+static struct heap_magazine *heap_magazines;
+static int heap_cpu_count;
+
+static uint32_t *heap_slab_bitmap;
+static addr_t heap_base;
+
+/*
+ * The large allocations are contiguous blocks of pages that have been
+ * allocated from the physical memory manager, so the kernel memory is
+ * not limited by the size of the heap. The 64-bit kernel uses the
+ * extended mappings for the blocks. The heap is used if there are no
+ * blocks available.
+ */
+#define HEAP_BLOCK_MIN_SIZE 0x4000
+#define HEAP_BLOCK_MAX_ORDER 10
+#define HEAP_BLOCK_HASH 64
+
+struct heap_block {
+	struct heap_block *next;
+	addr_t addr;
+	phys_addr_t page;
+	size_t page_count;
+};
+
+static struct heap_block *heap_blocks[HEAP_BLOCK_HASH];
+static int heap_block_lock;
+static int heap_block_ready;
+
+static void *heap_aligned_alloc(size_t alignment, size_t size);
+
 int heap_init(void)
 {
 	static int run_once;
-	size_t heap_size;
+	size_t heap_size, size;
+	int i, j;
 
 	if (!spin_trylock(&run_once))
 		return DE_UNEXPECTED;
@@ -57,6 +131,67 @@ int heap_init(void)
 	if (mtx_init(&heap_mtx, mtx_plain) != thrd_success)
 		return DE_UNEXPECTED;
 
+	for (i = 0, j = 0; i < HEAP_CACHE_COUNT; i++) {
+		struct heap_cache *c = &heap_caches[i];
+
+		c->object_size = heap_cache_sizes[i];
+		c->slab_objects = (0x1000 - HEAP_SLAB_HEADER) / c->object_size;
+
+		while (j * 16 <= c->object_size)
+			heap_cache_index[j++] = (unsigned char)i;
+	}
+
+	/*
+	 * The bitmap tells which pages of the heap are slabs.
+	 */
+	heap_base = kernel->heap_addr;
+	size = ((heap_size / 0x1000) + 31) / 32 * sizeof(uint32_t);
+
+	if ((heap_slab_bitmap = heap_aligned_alloc(16, size)) == NULL)
+		return DE_MEMORY;
+
+	memset(heap_slab_bitmap, 0, size);
+
+	return 0;
+}
+
+int heap_init_cpu(void)
+{
+	static int run_once;
+	int count = kernel->smp_ap_count + 1;
+	size_t size;
+
+	if (!spin_trylock(&run_once))
+		return DE_UNEXPECTED;
+
+	size = (size_t)(count * HEAP_CACHE_COUNT);
+	size *= sizeof(struct heap_magazine);
+
+	if ((heap_magazines = malloc(size)) == NULL)
+		return DE_MEMORY;
+
+	memset(heap_magazines, 0, size);
+
+	/*
+	 * The gdt_get_cpu function can be used after this.
+	 */
+	cpu_write32(&heap_cpu_count, (uint32_t)count);
+
+	return 0;
+}
+
+int heap_init_blocks(void)
+{
+	static int run_once;
+
+	if (!spin_trylock(&run_once))
+		return DE_UNEXPECTED;
+
+	/*
+	 * The physical memory manager and the tasks are ready.
+	 */
+	cpu_write32(&heap_block_ready, 1);
+
 	return 0;
 }
 
@@ -207,6 +342,432 @@ static void heap_free(const void *ptr)
 	}
 }
 
+static int heap_is_slab(const void *ptr)
+{
+	addr_t addr = (addr_t)ptr;
+	uint32_t bit;
+
+	if (heap_slab_bitmap == NULL || addr < heap_base)
+		return 0;
+
+	if (addr >= (addr_t)kernel->stack_array_addr)
+		return 0;
+
+	bit = (uint32_t)((addr - heap_base) >> 12);
+
+	return (int)((heap_slab_bitmap[bit / 32] >> (bit % 32)) & 1);
+}
+
+static struct heap_slab *heap_slab_create(struct heap_cache *c)
+{
+	struct heap_slab *slab;
+	unsigned char *p;
+	uint32_t bit;
+	int i;
+
+	if (mtx_lock(&heap_mtx) != thrd_success)
+		return NULL;
+
+	slab = heap_aligned_alloc(0x1000, 0x1000);
+
+	mtx_unlock(&heap_mtx);
+
+	if (slab == NULL)
+		return NULL;
+
+	memset(slab, 0, sizeof(*slab));
+
+	slab->cache = c;
+	slab->total = c->slab_objects;
+
+	p = (unsigned char *)slab + HEAP_SLAB_HEADER;
+
+	for (i = slab->total - 1; i >= 0; i--) {
+		void **object = (void **)(p + i * c->object_size);
+
+		*object = slab->free_list;
+		slab->free_list = object;
+	}
+
+	bit = (uint32_t)(((addr_t)slab - heap_base) >> 12);
+	cpu_bts32(&heap_slab_bitmap[bit / 32], bit % 32);
+
+	return slab;
+}
+
+static void heap_slab_delete(struct heap_slab *slab)
+{
+	uint32_t bit = (uint32_t)(((addr_t)slab - heap_base) >> 12);
+
+	cpu_btr32(&heap_slab_bitmap[bit / 32], bit % 32);
+
+	if (mtx_lock(&heap_mtx) != thrd_success)
+		return;
+
+	heap_free(slab);
+
+	mtx_unlock(&heap_mtx);
+}
+
+static void heap_slab_link(struct heap_cache *c, struct heap_slab *slab)
+{
+	slab->prev = NULL;
+
+	if ((slab->next = c->slabs) != NULL)
+		c->slabs->prev = slab;
+
+	c->slabs = slab;
+}
+
+static void heap_slab_unlink(struct heap_cache *c, struct heap_slab *slab)
+{
+	if (slab->prev != NULL)
+		slab->prev->next = slab->next;
+	else
+		c->slabs = slab->next;
+
+	if (slab->next != NULL)
+		slab->next->prev = slab->prev;
+
+	slab->next = NULL;
+	slab->prev = NULL;
+}
+
+static int heap_cache_get(struct heap_cache *c, void **objects, int n)
+{
+	void *lock_local = &c->lock;
+	struct heap_slab *slab = NULL;
+	int count = 0;
+
+	for (;;) {
+		spin_enter(&lock_local);
+
+		if (slab != NULL) {
+			heap_slab_link(c, slab);
+			c->slab_count += 1;
+			c->free_count += (size_t)slab->total;
+			c->empty_slabs += 1;
+		}
+
+		while (count < n && (slab = c->slabs) != NULL) {
+			void **object = slab->free_list;
+
+			slab->free_list = *object;
+			objects[count++] = object;
+
+			if (slab->used++ == 0)
+				c->empty_slabs -= 1;
+
+			if (slab->used == slab->total)
+				heap_slab_unlink(c, slab);
+
+			c->free_count -= 1;
+		}
+
+		spin_leave(&lock_local);
+
+		if (count > 0)
+			break;
+
+		/*
+		 * Allocate a new slab without holding the cache lock.
+		 */
+		if ((slab = heap_slab_create(c)) == NULL)
+			break;
+	}
+
+	return count;
+}
+
+static void heap_cache_put(struct heap_cache *c, void **objects, int n)
+{
+	void *lock_local = &c->lock;
+	struct heap_slab *release = NULL;
+	int i;
+
+	spin_enter(&lock_local);
+
+	for (i = 0; i < n; i++) {
+		void **object = objects[i];
+		struct heap_slab *slab;
+
+		slab = (struct heap_slab *)((addr_t)object & ~((addr_t)0xFFF));
+
+		if (slab->used == slab->total)
+			heap_slab_link(c, slab);
+
+		*object = slab->free_list;
+		slab->free_list = object;
+		c->free_count += 1;
+
+		if (--slab->used != 0)
+			continue;
+
+		/*
+		 * Keep one empty slab and release the others.
+		 */
+		if (c->empty_slabs == 0) {
+			c->empty_slabs += 1;
+			continue;
+		}
+
+		heap_slab_unlink(c, slab);
+		c->slab_count -= 1;
+		c->free_count -= (size_t)slab->total;
+
+		slab->next = release;
+		release = slab;
+	}
+
+	spin_leave(&lock_local);
+
+	while (release != NULL) {
+		struct heap_slab *slab = release;
+
+		release = slab->next;
+		heap_slab_delete(slab);
+	}
+}
+
+static struct heap_magazine *heap_magazine(int i)
+{
+	int count = (int)cpu_read32(&heap_cpu_count);
+	int cpu;
+
+	if (count == 0)
+		return NULL;
+
+	/*
+	 * The magazines have their own locks, so it does not matter if
+	 * the task is moved to another processor after this.
+	 */
+	cpu = gdt_get_cpu();
+
+	if (cpu < 0 || cpu >= count)
+		return NULL;
+
+	return &heap_magazines[cpu * HEAP_CACHE_COUNT + i];
+}
+
+static void *heap_small_alloc(size_t size)
+{
+	int i = (int)heap_cache_index[(size + 15) / 16];
+	struct heap_magazine *m = heap_magazine(i);
+	void *objects[HEAP_MAGAZINE_SIZE / 2];
+	void *lock_local, *ptr = NULL;
+	int n;
+
+	if (m != NULL) {
+		lock_local = &m->lock;
+		spin_enter(&lock_local);
+
+		if (m->count > 0)
+			ptr = m->objects[--m->count];
+
+		spin_leave(&lock_local);
+
+		if (ptr != NULL)
+			return ptr;
+	}
+
+	n = heap_cache_get(&heap_caches[i], &objects[0],
+		(m != NULL) ? HEAP_MAGAZINE_SIZE / 2 : 1);
+
+	if (n == 0)
+		return NULL;
+
+	ptr = objects[--n];
+
+	if (n > 0) {
+		lock_local = &m->lock;
+		spin_enter(&lock_local);
+
+		while (n > 0 && m->count < HEAP_MAGAZINE_SIZE)
+			m->objects[m->count++] = objects[--n];
+
+		spin_leave(&lock_local);
+
+		if (n > 0)
+			heap_cache_put(&heap_caches[i], &objects[0], n);
+	}
+
+	return ptr;
+}
+
+static void heap_small_free(void *ptr)
+{
+	struct heap_slab *slab;
+	struct heap_magazine *m;
+	void *objects[HEAP_MAGAZINE_SIZE / 2];
+	void *lock_local;
+	int i, n = 0;
+
+	slab = (struct heap_slab *)((addr_t)ptr & ~((addr_t)0xFFF));
+	i = (int)(slab->cache - &heap_caches[0]);
+
+	if ((m = heap_magazine(i)) == NULL) {
+		heap_cache_put(&heap_caches[i], &ptr, 1);
+		return;
+	}
+
+	lock_local = &m->lock;
+	spin_enter(&lock_local);
+
+	/*
+	 * Move half of the full magazine back to the slabs.
+	 */
+	if (m->count == HEAP_MAGAZINE_SIZE) {
+		while (n < HEAP_MAGAZINE_SIZE / 2)
+			objects[n++] = m->objects[--m->count];
+	}
+
+	m->objects[m->count++] = ptr;
+
+	spin_leave(&lock_local);
+
+	if (n > 0)
+		heap_cache_put(&heap_caches[i], &objects[0], n);
+}
+
+static void *heap_block_alloc(size_t size)
+{
+	void *lock_local = &heap_block_lock;
+	size_t page_count = (size + 0x0FFF) / 0x1000;
+	struct heap_block *block;
+	phys_addr_t page;
+	addr_t addr;
+	size_t i;
+	int order = 0;
+
+	if (!cpu_read32(&heap_block_ready) || size == 0)
+		return NULL;
+
+	while (((size_t)1 << order) < page_count) {
+		if (++order > HEAP_BLOCK_MAX_ORDER)
+			return NULL;
+	}
+
+	if ((block = heap_small_alloc(sizeof(*block))) == NULL)
+		return NULL;
+
+#ifdef DANCY_32
+	page = mm_alloc_pages(mm_kernel, order);
+	addr = (addr_t)page;
+#else
+	page = mm_alloc_pages(mm_addr36, order);
+	addr = 0;
+
+	if (page != 0) {
+		const addr_t high_bit = 0x8000000000000000ull;
+
+		pg_enter_kernel();
+		addr = (addr_t)pg_map_kernel(page, size, pg_extended);
+		pg_leave_kernel();
+
+		if ((addr & high_bit) == 0) {
+			mm_free_pages(page, order);
+			addr = 0;
+		}
+	}
+#endif
+	if (addr == 0) {
+		heap_small_free(block);
+		return NULL;
+	}
+
+	/*
+	 * Release the unused pages at the end of the block.
+	 */
+	for (i = page_count; i < ((size_t)1 << order); i++)
+		mm_free_page(page + (phys_addr_t)(i * 0x1000));
+
+	block->addr = addr;
+	block->page = page;
+	block->page_count = page_count;
+
+	i = (size_t)((addr >> 12) % HEAP_BLOCK_HASH);
+
+	spin_enter(&lock_local);
+	block->next = heap_blocks[i];
+	heap_blocks[i] = block;
+	spin_leave(&lock_local);
+
+	return (void *)addr;
+}
+
+static void heap_block_free(const void *ptr)
+{
+	void *lock_local = &heap_block_lock;
+	addr_t addr = (addr_t)ptr;
+	size_t i = (size_t)((addr >> 12) % HEAP_BLOCK_HASH);
+	struct heap_block **link = &heap_blocks[i];
+	struct heap_block *block;
+
+	spin_enter(&lock_local);
+
+	while ((block = *link) != NULL) {
+		if (block->addr == addr) {
+			*link = block->next;
+			break;
+		}
+		link = &block->next;
+	}
+
+	spin_leave(&lock_local);
+
+	if (block == NULL)
+		return;
+
+	for (i = 0; i < block->page_count; i++)
+		mm_free_page(block->page + (phys_addr_t)(i * 0x1000));
+
+	heap_small_free(block);
+}
+
+static int heap_is_block(const void *ptr)
+{
+	addr_t addr = (addr_t)ptr;
+
+	if (addr >= heap_base && addr < (addr_t)kernel->stack_array_addr)
+		return 0;
+
+	return 1;
+}
+
+int heap_cache_stat(int cache, struct heap_cache_stat *stat)
+{
+	struct heap_cache *c;
+	void *lock_local;
+	int count = (int)cpu_read32(&heap_cpu_count);
+	int i;
+
+	memset(stat, 0, sizeof(*stat));
+
+	if (cache < 0 || cache >= HEAP_CACHE_COUNT)
+		return DE_ARGUMENT;
+
+	c = &heap_caches[cache];
+	lock_local = &c->lock;
+
+	spin_enter(&lock_local);
+
+	stat->object_size = (size_t)c->object_size;
+	stat->slab_count = c->slab_count;
+	stat->object_count = c->slab_count * (size_t)c->slab_objects;
+	stat->free_count = c->free_count;
+
+	spin_leave(&lock_local);
+
+	for (i = 0; i < count; i++) {
+		struct heap_magazine *m;
+
+		m = &heap_magazines[i * HEAP_CACHE_COUNT + cache];
+		stat->magazine_count += (size_t)cpu_read32(&m->count);
+	}
+
+	return 0;
+}
+
 void *heap_alloc_static_page(void)
 {
 	const uint32_t used_bit = 1;
@@ -242,14 +803,24 @@ void *heap_alloc_static_page(void)
 
 void *aligned_alloc(size_t alignment, size_t size)
 {
-	void *ptr;
+	int block = (alignment != 0 && alignment <= 0x1000);
+	void *ptr = NULL;
 
-	if (mtx_lock(&heap_mtx) != thrd_success)
-		return NULL;
+	if (alignment <= 16 && size != 0 && size <= HEAP_CACHE_MAX_SIZE) {
+		if (alignment != 0 && (alignment & (alignment - 1)) == 0)
+			return heap_small_alloc(size);
+	}
 
-	ptr = heap_aligned_alloc(alignment, size);
+	if (block && size >= HEAP_BLOCK_MIN_SIZE)
+		ptr = heap_block_alloc(size);
 
-	mtx_unlock(&heap_mtx);
+	if (ptr == NULL && mtx_lock(&heap_mtx) == thrd_success) {
+		ptr = heap_aligned_alloc(alignment, size);
+		mtx_unlock(&heap_mtx);
+	}
+
+	if (ptr == NULL && block && size < HEAP_BLOCK_MIN_SIZE)
+		ptr = heap_block_alloc(size);
 
 	return ptr;
 }
@@ -262,14 +833,7 @@ void *calloc(size_t nmemb, size_t size)
 	if (mem_size == 0 || (mem_size / nmemb) != size)
 		return NULL;
 
-	if (mtx_lock(&heap_mtx) != thrd_success)
-		return NULL;
-
-	ptr = heap_aligned_alloc(16, mem_size);
-
-	mtx_unlock(&heap_mtx);
-
-	if (ptr)
+	if ((ptr = malloc(mem_size)) != NULL)
 		memset(ptr, 0, mem_size);
 
 	return ptr;
@@ -277,14 +841,21 @@ void *calloc(size_t nmemb, size_t size)
 
 void *malloc(size_t size)
 {
-	void *ptr;
+	void *ptr = NULL;
 
-	if (mtx_lock(&heap_mtx) != thrd_success)
-		return NULL;
+	if (size != 0 && size <= HEAP_CACHE_MAX_SIZE)
+		return heap_small_alloc(size);
 
-	ptr = heap_aligned_alloc(16, size);
+	if (size >= HEAP_BLOCK_MIN_SIZE)
+		ptr = heap_block_alloc(size);
 
-	mtx_unlock(&heap_mtx);
+	if (ptr == NULL && mtx_lock(&heap_mtx) == thrd_success) {
+		ptr = heap_aligned_alloc(16, size);
+		mtx_unlock(&heap_mtx);
+	}
+
+	if (ptr == NULL && size < HEAP_BLOCK_MIN_SIZE)
+		ptr = heap_block_alloc(size);
 
 	return ptr;
 }
@@ -294,6 +865,16 @@ void free(void *ptr)
 	if (!ptr)
 		return;
 
+	if (heap_is_slab(ptr)) {
+		heap_small_free(ptr);
+		return;
+	}
+
+	if (heap_is_block(ptr)) {
+		heap_block_free(ptr);
+		return;
+	}
+
 	if (mtx_lock(&heap_mtx) != thrd_success)
 		return;
 
@@ -313,12 +894,7 @@ char *strdup(const char *s)
 	for (i = 0; s[i] != '\0'; i++)
 		size += 1;
 
-	if (mtx_lock(&heap_mtx) != thrd_success)
-		return NULL;
-
-	ptr = heap_aligned_alloc(16, size);
-
-	mtx_unlock(&heap_mtx);
+	ptr = malloc(size);
 
 	if (ptr) {
 		for (i = 0; i < size; i++)
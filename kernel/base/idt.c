@@ -513,6 +513,8 @@ void idt_handler(int num, void *stack)
 		return;
 	}
 
+	gdt_get_data()->interrupts += 1;
+
 	/*
 	 * IRQ 0 - 15 (PIC).
 	 */
@@ -531,6 +533,25 @@ void idt_handler(int num, void *stack)
 		return;
 	}
 
+	/*
+	 * One-shot timer interrupt (bootstrap processor).
+	 */
+	if (num == 0x5E) {
+		apic_eoi();
+		timer_expire();
+		event_yield();
+		return;
+	}
+
+	/*
+	 * Reschedule interrupt for the real-time tasks (see sched.c).
+	 */
+	if (num == 0x5D) {
+		apic_eoi();
+		kernel->scheduler.preempt();
+		return;
+	}
+
 	/*
 	 * Event yield interrupt, which wakes up halted processors.
 	 */
@@ -554,6 +575,15 @@ void idt_handler(int num, void *stack)
 	if (num == 0xFF)
 		return;
 
+	/*
+	 * Device-not-available exception. The floating point state of
+	 * the current task is restored lazily (see task.c).
+	 */
+	if (num == 0x07) {
+		task_restore_fstate();
+		return;
+	}
+
 	/*
 	 * User space exceptions.
 	 */
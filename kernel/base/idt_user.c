@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023 Antti Tiihala
+ * Copyright (c) 2023, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -117,6 +117,9 @@ int idt_user_exception(int num, void *stack)
 		cpu_native_t code = p[-1];
 		cpu_native_t cr2 = cpu_read_cr2();
 
+		if ((code & 1) == 0 && !pg_fault_user((addr_t)cr2))
+			return 0;
+
 		if ((code & 1) == 0 && cr2 >= stack_min && cr2 <= stack_max) {
 			if (pg_map_user((addr_t)cr2, 1, pg_noexec))
 				return 0;
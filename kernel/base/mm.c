@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021 Antti Tiihala
+ * Copyright (c) 2021, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -23,9 +23,210 @@ static mtx_t mm_mtx;
 static int mm_ready;
 
 static size_t mm_bitmap_size;
-static size_t mm_bitmap_used;
 static uint8_t *mm_bitmap;
 
+/*
+ * The free pages are managed with a buddy allocator. Each zone has its
+ * own free lists, and the blocks never cross the zone boundaries, so
+ * that the address constraints of the memory types are easy to meet.
+ * The lists are linked with page frame numbers (zero is the end) and
+ * the mm_order array has the order of each free block at its first
+ * page frame. Other page frames have the value MM_ORDER_NONE.
+ */
+#define MM_ORDER_COUNT 11
+#define MM_ORDER_NONE 0xFF
+#define MM_ZONE_COUNT 6
+
+struct mm_link {
+	uint32_t next;
+	uint32_t prev;
+};
+
+struct mm_zone {
+	size_t free_pages;
+	uint32_t head[MM_ORDER_COUNT];
+};
+
+static size_t mm_frame_count;
+static struct mm_link *mm_links;
+static uint8_t *mm_order;
+
+static struct mm_zone mm_zones[MM_ZONE_COUNT];
+
+/*
+ * Each processor has a small cache of free page frames in front of the
+ * buddy allocator. The caches are refilled and drained in batches, so
+ * most of the mm_alloc_page and mm_free_page calls do not use mm_mtx.
+ * The MM_CACHE_SIZE value can be zero if the caches are not wanted.
+ */
+#define MM_CACHE_SIZE 32
+#define MM_CACHE_BATCH (MM_CACHE_SIZE / 2 + 1)
+
+struct mm_cache {
+	int lock;
+	int count;
+	size_t page_frames[MM_CACHE_SIZE + 1];
+};
+
+static struct mm_cache *mm_caches;
+static int mm_cache_count;
+static uint32_t mm_cached_pages;
+
+/*
+ * The pool of zeroed page frames is filled by the caretaker task, so
+ * the user pages and the page tables are usually not zeroed when they
+ * are allocated. The pooled pages are counted as cached pages.
+ */
+#define MM_ZERO_SIZE 256
+
+static int mm_zero_lock;
+static int mm_zero_count;
+static size_t mm_zero_frames[MM_ZERO_SIZE];
+
+static const size_t mm_zone_limit[MM_ZONE_COUNT - 1] = {
+	0x100, 0x1000, 0x10000, 0x100000, 0x1000000
+};
+
+static size_t mm_size(int order)
+{
+	return (size_t)1 << order;
+}
+
+static int mm_get_zone(size_t page_frame)
+{
+	int i;
+
+	for (i = 0; i < MM_ZONE_COUNT - 1; i++) {
+		if (page_frame < mm_zone_limit[i])
+			return i;
+	}
+
+	return MM_ZONE_COUNT - 1;
+}
+
+static int mm_type_zone(int type)
+{
+	switch (type) {
+	case mm_normal:
+		return MM_ZONE_COUNT - 1;
+	case mm_addr36:
+		return 4;
+	case mm_addr32:
+		return 3;
+	case mm_addr28:
+		return 2;
+	case mm_addr24:
+		return 1;
+	case mm_addr20:
+		return 0;
+	case mm_kernel:
+		return 2;
+	default:
+		break;
+	}
+
+	return -1;
+}
+
+static void mm_list_insert(size_t page_frame, int order)
+{
+	struct mm_zone *zone = &mm_zones[mm_get_zone(page_frame)];
+	uint32_t head = zone->head[order];
+
+	mm_links[page_frame].next = head;
+	mm_links[page_frame].prev = 0;
+
+	if (head != 0)
+		mm_links[head].prev = (uint32_t)page_frame;
+
+	zone->head[order] = (uint32_t)page_frame;
+	mm_order[page_frame] = (uint8_t)order;
+}
+
+static void mm_list_remove(size_t page_frame, int order)
+{
+	struct mm_zone *zone = &mm_zones[mm_get_zone(page_frame)];
+	uint32_t next = mm_links[page_frame].next;
+	uint32_t prev = mm_links[page_frame].prev;
+
+	if (prev != 0)
+		mm_links[prev].next = next;
+	else
+		zone->head[order] = next;
+
+	if (next != 0)
+		mm_links[next].prev = prev;
+
+	mm_order[page_frame] = MM_ORDER_NONE;
+}
+
+static void mm_buddy_free(size_t page_frame, int order)
+{
+	int zone = mm_get_zone(page_frame);
+
+	mm_zones[zone].free_pages += mm_size(order);
+
+	/*
+	 * Merge the block with its buddy as long as the buddy is free
+	 * and the merged block is in the same zone.
+	 */
+	while (order < MM_ORDER_COUNT - 1) {
+		size_t size = mm_size(order);
+		size_t buddy = page_frame ^ size;
+		size_t first = (page_frame < buddy) ? page_frame : buddy;
+
+		if (buddy == 0 || buddy >= mm_frame_count)
+			break;
+
+		if (mm_order[buddy] != (uint8_t)order)
+			break;
+
+		if (mm_get_zone(first) != zone)
+			break;
+
+		if (mm_get_zone(first + (size * 2) - 1) != zone)
+			break;
+
+		mm_list_remove(buddy, order);
+		page_frame = first;
+		order += 1;
+	}
+
+	mm_list_insert(page_frame, order);
+}
+
+static size_t mm_buddy_alloc(int max_zone, int order)
+{
+	int i, j;
+
+	for (i = max_zone; i >= 0; i--) {
+		struct mm_zone *zone = &mm_zones[i];
+
+		for (j = order; j < MM_ORDER_COUNT; j++) {
+			size_t page_frame = zone->head[j];
+
+			if (page_frame == 0)
+				continue;
+
+			mm_list_remove(page_frame, j);
+
+			/*
+			 * Split the block and give back the upper halves.
+			 */
+			while (j > order) {
+				j -= 1;
+				mm_list_insert(page_frame + mm_size(j), j);
+			}
+
+			zone->free_pages -= mm_size(order);
+
+			return page_frame;
+		}
+	}
+
+	return 0;
+}
+
 static void mm_bitmap_clear(size_t page_frame, size_t page_count)
 {
 	unsigned int b = (unsigned int)(page_frame & 7u);
@@ -74,6 +275,24 @@ static int mm_bitmap_test(size_t page_frame, size_t page_count)
 	return 0;
 }
 
+static int mm_bitmap_full(size_t page_frame, size_t page_count)
+{
+	unsigned int b = (unsigned int)(page_frame & 7u);
+	size_t i = (page_frame >> 3);
+
+	while (page_count--) {
+		unsigned int val = mm_bitmap[i];
+
+		if ((val & (1u << b)) == 0)
+			return 0;
+
+		if ((b = (b + 1) & 7u) == 0)
+			i += 1;
+	}
+
+	return 1;
+}
+
 static int mm_get_count(int order)
 {
 	static const int table[11] = {
@@ -88,6 +307,53 @@ static int mm_get_count(int order)
 	return 0;
 }
 
+static void mm_buddy_init(void)
+{
+	size_t page_frame = 1;
+
+	/*
+	 * Add the free pages to the free lists. The blocks are as large
+	 * as possible, but the buddy_free function merges them anyway.
+	 */
+	while (page_frame < mm_frame_count) {
+		int zone = mm_get_zone(page_frame);
+		int order = 0;
+
+		if ((page_frame & 7u) == 0) {
+			if (mm_bitmap[page_frame >> 3] == 0xFF) {
+				page_frame += 8;
+				continue;
+			}
+		}
+
+		if (mm_bitmap_test(page_frame, 1)) {
+			page_frame += 1;
+			continue;
+		}
+
+		while (order < MM_ORDER_COUNT - 1) {
+			size_t size = mm_size(order + 1);
+
+			if ((page_frame & (size - 1)) != 0)
+				break;
+
+			if (page_frame + size > mm_frame_count)
+				break;
+
+			if (mm_get_zone(page_frame + size - 1) != zone)
+				break;
+
+			if (mm_bitmap_test(page_frame + (size / 2), size / 2))
+				break;
+
+			order += 1;
+		}
+
+		mm_buddy_free(page_frame, order);
+		page_frame += mm_size(order);
+	}
+}
+
 int mm_init(void)
 {
 	static int run_once;
@@ -101,6 +367,7 @@ int mm_init(void)
 	size_t map_size = kernel->memory_map_size;
 	int map_entries = (int)(map_size / sizeof(kernel->memory_map[0]));
 	void *heap_reserved, *ptr;
+	size_t meta_size;
 	int i;
 
 	if (!spin_trylock(&run_once))
@@ -173,11 +440,23 @@ int mm_init(void)
 			mm_bitmap_size = size;
 	}
 
+	/*
+	 * The bitmap is followed by the buddy allocator data.
+	 */
+	mm_frame_count = mm_bitmap_size * 8;
+
+	if (mm_frame_count > 0xFFFFFFFF)
+		mm_frame_count = 0xFFFFFFFF;
+
+	meta_size = mm_frame_count * sizeof(struct mm_link);
+	meta_size += mm_bitmap_size + mm_frame_count;
+	meta_size = (meta_size + 0x0FFF) & (~((size_t)0x0FFF));
+
 #ifdef DANCY_32
-	mm_bitmap = aligned_alloc(0x1000, mm_bitmap_size);
+	mm_bitmap = aligned_alloc(0x1000, meta_size);
 #else
 	for (i = mm_count - 1; i >= 0; i--) {
-		size_t bitmap_page_count = mm_bitmap_size / 0x1000;
+		size_t bitmap_page_count = meta_size / 0x1000;
 
 		size_t page_frame = mm_array[i].page_frame;
 		size_t page_count = mm_array[i].page_count;
@@ -207,7 +486,7 @@ int mm_init(void)
 		/*
 		 * On 64-bit systems, the bitmap size can be quite large.
 		 */
-		mm_bitmap = pg_map_kernel(addr, mm_bitmap_size, pg_extended);
+		mm_bitmap = pg_map_kernel(addr, meta_size, pg_extended);
 
 		mm_array[i].page_frame = page_frame;
 		mm_array[i].page_count = page_count;
@@ -219,6 +498,11 @@ int mm_init(void)
 
 	memset(mm_bitmap, 0xFF, mm_bitmap_size);
 
+	mm_links = (struct mm_link *)((addr_t)mm_bitmap + mm_bitmap_size);
+	mm_order = (uint8_t *)(&mm_links[mm_frame_count]);
+
+	memset(mm_order, MM_ORDER_NONE, mm_frame_count);
+
 	/*
 	 * Verify that the bitmap really has all pages "allocated"
 	 * initially. The memory manager would behave in a really
@@ -259,8 +543,6 @@ int mm_init(void)
 		mm_bitmap_clear(page_frame, page_count);
 	}
 
-	free(mm_array);
-
 	/*
 	 * Give almost all heap memory to the physical memory manager.
 	 */
@@ -288,8 +570,20 @@ int mm_init(void)
 		}
 	}
 
+	mm_buddy_init();
 	cpu_write32((uint32_t *)&mm_ready, 1);
 
+	if (MM_CACHE_SIZE > 0) {
+		int count = kernel->smp_ap_count + 1;
+		size_t size = (size_t)count * sizeof(struct mm_cache);
+
+		if ((mm_caches = malloc(size)) == NULL)
+			return free(mm_array), DE_MEMORY;
+
+		memset(mm_caches, 0, size);
+		cpu_write32((uint32_t *)&mm_cache_count, (uint32_t)count);
+	}
+
 	/*
 	 * Now the physical memory manager has been initialized and
 	 * all free memory areas from 4 GiB to 128 TiB can be mapped.
@@ -307,209 +601,259 @@ int mm_init(void)
 			size = mm_array[i].page_count * 0x1000;
 
 			if (!pg_map_kernel(addr, size, pg_normal))
-				return DE_MEMORY;
+				return free(mm_array), DE_MEMORY;
 		}
 	}
 #endif
+	/*
+	 * The memory map is not needed after the areas above 4 GiB
+	 * have been mapped.
+	 */
+	free(mm_array);
+
 	return 0;
 }
 
-size_t mm_available_pages(int type)
+static struct mm_cache *mm_get_cache(void)
 {
-	size_t page_frame = mm_bitmap_size * 8;
-	size_t pages = 0;
-	size_t i;
-
-	if (!mm_ready)
-		return 0;
+	int count = (int)cpu_read32(&mm_cache_count);
+	int cpu;
 
-	if (type != mm_normal) {
-		if (type == mm_addr36) {
-			if (page_frame > 0x1000000)
-				page_frame = 0x1000000;
+	if (count == 0)
+		return NULL;
 
-		} else if (type == mm_addr32) {
-			if (page_frame > 0x100000)
-				page_frame = 0x100000;
-
-		} else if (type == mm_addr28) {
-			if (page_frame > 0x10000)
-				page_frame = 0x10000;
+	/*
+	 * The caches have their own locks, so it does not matter if
+	 * the task is moved to another processor after this.
+	 */
+	cpu = gdt_get_cpu();
 
-		} else if (type == mm_addr24) {
-			if (page_frame > 0x1000)
-				page_frame = 0x1000;
+	if (cpu < 0 || cpu >= count)
+		return NULL;
 
-		} else if (type == mm_addr20) {
-			if (page_frame > 0x100)
-				page_frame = 0x100;
+	return &mm_caches[cpu];
+}
 
-		} else if (type == mm_kernel) {
-			if (page_frame > 0x10000)
-				page_frame = 0x10000;
+static void mm_free_array(size_t *page_frames, int count)
+{
+	int i;
 
-		} else /* unknown memory type */ {
-			return 0;
-		}
-	}
+	if (count == 0)
+		return;
 
 	if (mtx_lock(&mm_mtx) != thrd_success)
-		return 0;
-
-	for (i = 0; i < (page_frame >> 3); i++) {
-		unsigned int val = mm_bitmap[i];
-		unsigned int b;
+		return;
 
-		for (b = 0; b < 8; b++) {
-			if ((val & (1u << b)) == 0)
-				pages += 1;
+	for (i = 0; i < count; i++) {
+		if (mm_bitmap_full(page_frames[i], 1)) {
+			mm_bitmap_clear(page_frames[i], 1);
+			mm_buddy_free(page_frames[i], 0);
 		}
 	}
 
 	mtx_unlock(&mm_mtx);
-
-	return pages;
 }
 
-phys_addr_t mm_alloc_page(void)
+static void mm_drain_caches(void)
 {
-	size_t page_frame, size;
-	phys_addr_t page = 0;
+	int count = (int)cpu_read32(&mm_cache_count);
+	int i;
 
-	if (!mm_ready)
-		return 0;
+	for (i = 0; i < count; i++) {
+		struct mm_cache *c = &mm_caches[i];
+		size_t page_frames[MM_CACHE_SIZE + 1];
+		void *lock_local = &c->lock;
+		int n = 0;
 
-	if (mtx_lock(&mm_mtx) != thrd_success)
-		return 0;
+		spin_enter(&lock_local);
 
-	size = mm_bitmap_size - mm_bitmap_used;
-	page_frame = (size * 8);
+		while (c->count > 0)
+			page_frames[n++] = c->page_frames[--c->count];
 
-	while (size != 0 && mm_bitmap[--size] == 0xFF) {
-		mm_bitmap_used += 1;
-		page_frame -= 8;
+		spin_leave(&lock_local);
+
+		cpu_sub32(&mm_cached_pages, (uint32_t)n);
+		mm_free_array(&page_frames[0], n);
 	}
 
-	if (page_frame)
-		page_frame = (page_frame - 1);
+	for (;;) {
+		size_t page_frames[MM_CACHE_BATCH];
+		void *lock_local = &mm_zero_lock;
+		int n = 0;
 
-	while (page_frame) {
-		unsigned int b = (unsigned int)(page_frame & 7u);
-		unsigned int t = 1u << b;
-		size_t i = (page_frame >> 3);
-		unsigned int val = mm_bitmap[i];
+		spin_enter(&lock_local);
 
-		if ((val & t) == 0) {
-			mm_bitmap[i] = (uint8_t)(val | t);
-			page = page_frame * 0x1000;
+		while (n < MM_CACHE_BATCH && mm_zero_count > 0)
+			page_frames[n++] = mm_zero_frames[--mm_zero_count];
+
+		spin_leave(&lock_local);
+
+		if (n == 0)
 			break;
-		}
 
-		page_frame -= 1;
+		cpu_sub32(&mm_cached_pages, (uint32_t)n);
+		mm_free_array(&page_frames[0], n);
 	}
+}
 
-	mtx_unlock(&mm_mtx);
+size_t mm_available_pages(int type)
+{
+	int max_zone = mm_type_zone(type);
+	size_t pages = 0;
+	int i;
+
+	if (!mm_ready)
+		return 0;
 
-	return page;
+	for (i = 0; i <= max_zone; i++)
+		pages += mm_zones[i].free_pages;
+
+	if (type == mm_normal)
+		pages += (size_t)cpu_read32(&mm_cached_pages);
+
+	return pages;
 }
 
-phys_addr_t mm_alloc_pages(int type, int order)
+phys_addr_t mm_alloc_page(void)
 {
-	size_t page_count = (size_t)mm_get_count(order);
-	size_t page_frame, size;
-	phys_addr_t page = 0;
+	size_t page_frames[MM_CACHE_BATCH];
+	struct mm_cache *c;
+	void *lock_local;
+	size_t page_frame = 0;
+	int n = 0;
 
-	if (!mm_ready || !page_count)
+	if (!mm_ready)
 		return 0;
 
+	if ((c = mm_get_cache()) == NULL)
+		return mm_alloc_pages(mm_normal, 0);
+
+	lock_local = &c->lock;
+	spin_enter(&lock_local);
+
+	if (c->count > 0)
+		page_frame = c->page_frames[--c->count];
+
+	spin_leave(&lock_local);
+
+	if (page_frame != 0) {
+		cpu_sub32(&mm_cached_pages, 1);
+		return (phys_addr_t)page_frame * 0x1000;
+	}
+
+	/*
+	 * Refill the cache. The first page frame is returned.
+	 */
 	if (mtx_lock(&mm_mtx) != thrd_success)
 		return 0;
 
-	size = mm_bitmap_size - mm_bitmap_used;
-	page_frame = (size * 8);
+	while (n < MM_CACHE_BATCH) {
+		int max_zone = MM_ZONE_COUNT - 1;
 
-	while (size != 0 && mm_bitmap[--size] == 0xFF) {
-		mm_bitmap_used += 1;
-		page_frame -= 8;
+		if ((page_frame = mm_buddy_alloc(max_zone, 0)) == 0)
+			break;
+
+		mm_bitmap_set(page_frame, 1);
+		page_frames[n++] = page_frame;
 	}
 
-	if (type != mm_normal) {
-		if (type == mm_addr36) {
-			if (page_frame > 0x1000000)
-				page_frame = 0x1000000;
+	mtx_unlock(&mm_mtx);
 
-		} else if (type == mm_addr32) {
-			if (page_frame > 0x100000)
-				page_frame = 0x100000;
+	if (n == 0)
+		return mm_alloc_pages(mm_normal, 0);
 
-		} else if (type == mm_addr28) {
-			if (page_frame > 0x10000)
-				page_frame = 0x10000;
+	page_frame = page_frames[--n];
 
-		} else if (type == mm_addr24) {
-			if (page_frame > 0x1000)
-				page_frame = 0x1000;
+	spin_enter(&lock_local);
 
-		} else if (type == mm_addr20) {
-			if (page_frame > 0x100)
-				page_frame = 0x100;
+	while (n > 0 && c->count < MM_CACHE_SIZE) {
+		c->page_frames[c->count++] = page_frames[--n];
+		cpu_add32(&mm_cached_pages, 1);
+	}
 
-		} else if (type == mm_kernel) {
-			if (page_frame > 0x10000)
-				page_frame = 0x10000;
+	spin_leave(&lock_local);
 
-		} else /* unknown memory type */ {
-			page_frame = 0;
-		}
-	}
+	mm_free_array(&page_frames[0], n);
+
+	return (phys_addr_t)page_frame * 0x1000;
+}
+
+phys_addr_t mm_alloc_pages(int type, int order)
+{
+	size_t page_count = (size_t)mm_get_count(order);
+	int max_zone = mm_type_zone(type);
+	size_t page_frame = 0;
+	int i;
+
+	if (!mm_ready || !page_count || max_zone < 0)
+		return 0;
+
+	for (i = 0; i < 2; i++) {
+		if (mtx_lock(&mm_mtx) != thrd_success)
+			return 0;
 
-	if (page_frame)
-		page_frame = (page_frame - 1) & (~(page_count - 1));
+		page_frame = mm_buddy_alloc(max_zone, order);
 
-	while (page_frame) {
-		if (!mm_bitmap_test(page_frame, page_count)) {
+		if (page_frame != 0)
 			mm_bitmap_set(page_frame, page_count);
-			page = page_frame * 0x1000;
+
+		mtx_unlock(&mm_mtx);
+
+		if (page_frame != 0 || !cpu_read32(&mm_cached_pages))
 			break;
-		}
 
-		page_frame -= page_count;
+		/*
+		 * The per-processor caches may have the pages that are
+		 * needed for merging the blocks or for meeting the address
+		 * constraints.
+		 */
+		mm_drain_caches();
 	}
 
-	mtx_unlock(&mm_mtx);
-
-	return page;
+	return (phys_addr_t)page_frame * 0x1000;
 }
 
 void mm_free_page(phys_addr_t addr)
 {
 	size_t page_frame = (size_t)(addr >> 12);
-	unsigned int b;
-	size_t i;
+	size_t page_frames[MM_CACHE_BATCH];
+	struct mm_cache *c;
+	void *lock_local;
+	int n = 0;
 
-	if (!mm_ready || !page_frame)
+	if (!mm_ready || !page_frame || page_frame >= mm_frame_count)
 		return;
 
-	if ((i = page_frame / 8) >= mm_bitmap_size)
+	if ((c = mm_get_cache()) == NULL) {
+		mm_free_pages(addr, 0);
 		return;
+	}
 
-	if (mtx_lock(&mm_mtx) != thrd_success)
-		return;
+	lock_local = &c->lock;
+	spin_enter(&lock_local);
+
+	/*
+	 * Drain a batch of page frames if the cache is full.
+	 */
+	if (c->count >= MM_CACHE_SIZE) {
+		while (n < MM_CACHE_BATCH && c->count > 0)
+			page_frames[n++] = c->page_frames[--c->count];
+	}
 
-	b = (unsigned int)(page_frame & 7u);
-	mm_bitmap[i] = (uint8_t)(mm_bitmap[i] & (~(1u << b)));
+	c->page_frames[c->count++] = page_frame;
 
-	if (mm_bitmap_used > (i = (mm_bitmap_size - i) - 1))
-		mm_bitmap_used = i;
+	spin_leave(&lock_local);
 
-	mtx_unlock(&mm_mtx);
+	cpu_add32(&mm_cached_pages, 1);
+	cpu_sub32(&mm_cached_pages, (uint32_t)n);
+
+	mm_free_array(&page_frames[0], n);
 }
 
 void mm_free_pages(phys_addr_t addr, int order)
 {
 	size_t page_frame = (size_t)(addr >> 12);
 	size_t page_count = (size_t)mm_get_count(order);
-	size_t i;
 
 	if (!mm_ready || !page_count)
 		return;
@@ -517,16 +861,80 @@ void mm_free_pages(phys_addr_t addr, int order)
 	if (!page_frame || (page_frame & (page_count - 1)) != 0)
 		return;
 
-	if ((i = (page_frame + (page_count - 1)) / 8) >= mm_bitmap_size)
+	if (page_frame + page_count > mm_frame_count)
 		return;
 
 	if (mtx_lock(&mm_mtx) != thrd_success)
 		return;
 
-	mm_bitmap_clear(page_frame, page_count);
-
-	if (mm_bitmap_used > (i = (mm_bitmap_size - i) - 1))
-		mm_bitmap_used = i;
+	/*
+	 * Ignore the pages that are not allocated. Freeing them twice
+	 * would break the free lists.
+	 */
+	if (mm_bitmap_full(page_frame, page_count)) {
+		mm_bitmap_clear(page_frame, page_count);
+		mm_buddy_free(page_frame, order);
+	}
 
 	mtx_unlock(&mm_mtx);
 }
+
+phys_addr_t mm_alloc_zero_page(void)
+{
+	void *lock_local = &mm_zero_lock;
+	size_t page_frame = 0;
+	phys_addr_t addr;
+
+	if (cpu_read32(&mm_zero_count) != 0) {
+		spin_enter(&lock_local);
+
+		if (mm_zero_count > 0)
+			page_frame = mm_zero_frames[--mm_zero_count];
+
+		spin_leave(&lock_local);
+	}
+
+	if (page_frame != 0) {
+		cpu_sub32(&mm_cached_pages, 1);
+		return (phys_addr_t)page_frame * 0x1000;
+	}
+
+	if ((addr = mm_alloc_page()) != 0)
+		memset((void *)addr, 0, 0x1000);
+
+	return addr;
+}
+
+void mm_zero_pages(void)
+{
+	void *lock_local = &mm_zero_lock;
+
+	while ((int)cpu_read32(&mm_zero_count) < MM_ZERO_SIZE) {
+		phys_addr_t addr;
+
+		if ((addr = mm_alloc_page()) == 0)
+			break;
+
+		/*
+		 * The non-temporal stores do not fill the caches with
+		 * the zeroed pages.
+		 */
+		cpu_zero_page((void *)addr);
+		cpu_add32(&mm_cached_pages, 1);
+
+		spin_enter(&lock_local);
+
+		if (mm_zero_count < MM_ZERO_SIZE) {
+			mm_zero_frames[mm_zero_count++] = (size_t)(addr >> 12);
+			addr = 0;
+		}
+
+		spin_leave(&lock_local);
+
+		if (addr != 0) {
+			cpu_sub32(&mm_cached_pages, 1);
+			mm_free_page(addr);
+			break;
+		}
+	}
+}
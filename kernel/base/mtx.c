@@ -24,7 +24,7 @@ static int base_mtx_lock;
 struct base_mtx {
 	int init;
 	int lock;
-	int yield;
+	struct waitq waitq;
 };
 
 #define BASE_MTX_COUNT 128
@@ -33,13 +33,6 @@ static struct base_mtx base_mtx_array[BASE_MTX_COUNT];
 #define null_mxt (mtx == NULL || *mtx == NULL)
 #define this_mtx ((struct base_mtx *)(*mtx))
 
-static int base_mtx_lock_func(uint64_t *data)
-{
-	int *lock = (int *)((addr_t)data[0]);
-
-	return *lock;
-}
-
 void mtx_destroy(mtx_t *mtx)
 {
 	if (null_mxt)
@@ -63,7 +56,7 @@ int mtx_init(mtx_t *mtx, int type)
 		if (base_mtx_array[i].init == 0) {
 			m = &base_mtx_array[i];
 			m->init = 1;
-			m->yield = 0;
+			waitq_init(&m->waitq);
 			spin_unlock(&m->lock);
 			*mtx = m;
 			break;
@@ -84,15 +77,17 @@ int mtx_lock(mtx_t *mtx)
 		return thrd_error;
 
 	while (!spin_trylock(&this_mtx->lock)) {
-		uint64_t data = (uint64_t)((addr_t)&this_mtx->lock);
+		struct waitq_entry entry;
 
-		this_mtx->yield = 1;
+		task_block_prepare(0);
+		waitq_add(&this_mtx->waitq, &entry);
 
-		task_write_event(base_mtx_lock_func, data, 0);
+		if (cpu_read32(&this_mtx->lock))
+			task_block();
+		else
+			task_block_cancel();
 
-		do {
-			task_yield();
-		} while(task_read_event());
+		waitq_remove(&this_mtx->waitq, &entry);
 	}
 
 	return thrd_success;
@@ -114,17 +109,12 @@ int mtx_trylock(mtx_t *mtx)
 
 int mtx_unlock(mtx_t *mtx)
 {
-	int yield;
-
 	if (null_mxt)
 		return thrd_error;
 
-	yield = this_mtx->yield;
-	this_mtx->yield = 0;
-
 	spin_unlock(&this_mtx->lock);
 
-	if (yield)
+	if (waitq_wake_one(&this_mtx->waitq) != NULL)
 		task_yield();
 
 	return thrd_success;
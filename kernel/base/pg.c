@@ -31,6 +31,19 @@ static int pg_rw_lock;
 static addr_t pg_rw_entry;
 static addr_t pg_rw_vaddr;
 
+/*
+ * The kernel address space uses the process-context identifier 0 and
+ * all the user address spaces use the identifier 1. The array has the
+ * user address space (and its generation) that owns the identifier 1
+ * on each processor.
+ */
+static struct {
+	cpu_native_t cr3;
+	uint32_t generation;
+} *pg_pcid_owner;
+
+static int pg_pcid_count;
+
 enum pg_size_type {
 	pg_mega_type = 1,
 	pg_giga_type = 2
@@ -39,6 +52,7 @@ enum pg_size_type {
 #ifdef DANCY_32
 
 static const cpu_native_t pg_cr3_mask = (cpu_native_t)(0xFFFFF000);
+static const cpu_native_t pg_cr3_noflush = (cpu_native_t)(0);
 
 static uint32_t pg_alloc_static_page(void)
 {
@@ -71,6 +85,10 @@ static int pg_free_pte(uint32_t *pte, int sync_arctic)
 			r += 1;
 			continue;
 		}
+		if ((pte[i] & 0x600) != 0) {
+			pte[i] = 0;
+			continue;
+		}
 		p = (phys_addr_t)pte[i], pte[i] = 0;
 		mm_free_page(p);
 		current->pg_user_memory -= 0x1000;
@@ -79,6 +97,42 @@ static int pg_free_pte(uint32_t *pte, int sync_arctic)
 	return r;
 }
 
+static void pg_free_large(uint32_t *pde, int sync_arctic)
+{
+	phys_addr_t p;
+
+	if (sync_arctic && (*pde & 0x800) != 0) {
+		*pde ^= 0x800;
+		return;
+	}
+
+	p = (phys_addr_t)(*pde & 0xFFC00000), *pde = 0;
+	mm_free_pages(p, 10);
+	task_current()->pg_user_memory -= 0x400000;
+}
+
+static int pg_split_large(uint32_t *pde)
+{
+	uint32_t page = *pde & 0xFFC00000;
+	uint32_t page_bits = *pde & 0x00000F7F;
+	uint32_t *pte;
+	int i;
+
+	/*
+	 * The 4 MiB page is replaced with a page table that maps the
+	 * same physical pages. The bit 7 (PS) is PAT in the entries.
+	 */
+	if ((pte = (uint32_t *)mm_alloc_page()) == NULL)
+		return 1;
+
+	for (i = 0; i < 1024; i++)
+		pte[i] = (page + (uint32_t)(i * 0x1000)) | page_bits;
+
+	*pde = (uint32_t)pte | 0x27;
+
+	return 0;
+}
+
 static void pg_delete_cr3(cpu_native_t cr3, int sync_arctic)
 {
 	const uint32_t entry_mask = 0xFFFFF000;
@@ -93,8 +147,10 @@ static void pg_delete_cr3(cpu_native_t cr3, int sync_arctic)
 	for (i = 64; i < 1024; i++) {
 		if ((pde[i] & 0x01) == 0)
 			continue;
-		if ((pde[i] & 0x80) != 0)
+		if ((pde[i] & 0x80) != 0) {
+			pg_free_large(&pde[i], sync_arctic);
 			continue;
+		}
 		/*
 		 * Page table.
 		 */
@@ -202,13 +258,13 @@ static int pg_map_virtual(cpu_native_t cr3,
 	ptr = (uint32_t *)(cr3 & pg_cr3_mask);
 
 	if ((ptr[offset] & 1) == 0) {
-		if ((page = (uint32_t)mm_alloc_page()) == 0)
+		if ((page = (uint32_t)mm_alloc_zero_page()) == 0)
 			return 1;
-		memset((void *)page, 0, 0x1000);
 		ptr[offset] = page | page_bits;
 
 	} else if ((ptr[offset] & 0x80) != 0) {
-		return 1;
+		if ((ptr[offset] & 0x04) == 0 || pg_split_large(&ptr[offset]))
+			return 1;
 	}
 
 	/*
@@ -228,7 +284,16 @@ static int pg_map_virtual(cpu_native_t cr3,
 	if ((type & pg_arctic) != 0)
 		page_bits |= 0x800;
 
-	if (ptr[offset] == 0) {
+	if ((type & pg_lazy) != 0)
+		page = 0, page_bits = (page_bits & 0xFFE) | 0x200;
+
+	if ((type & pg_lazy) != 0 && (type & pg_blocked) != 0)
+		page_bits |= 0x400;
+
+	if ((type & pg_shared) != 0)
+		page_bits = (page_bits & 0xFFD) | 0x400;
+
+	if (ptr[offset] == 0 || (ptr[offset] & 0x600) != 0) {
 		ptr[offset] = page | page_bits;
 	} else {
 		uint32_t old_page = ptr[offset] & 0xFFFFF000;
@@ -263,13 +328,61 @@ void *pg_get_entry(cpu_native_t cr3, const void *pte)
 	return &ptr[offset];
 }
 
+static void *pg_get_large(cpu_native_t cr3, const void *pte)
+{
+	addr_t addr = (addr_t)pte;
+	int offset = (int)(addr >> 22);
+	uint32_t *ptr;
+
+	/*
+	 * Page-directory table.
+	 */
+	ptr = (uint32_t *)(cr3 & pg_cr3_mask);
+
+	if ((ptr[offset] & 0x85) != 0x85)
+		return NULL;
+
+	return &ptr[offset];
+}
+
+static int pg_map_large(cpu_native_t cr3,
+	addr_t vaddr, phys_addr_t addr, int type)
+{
+	uint32_t page_bits = 0x27;
+	int offset = (int)(vaddr >> 22);
+	uint32_t page, *ptr;
+
+	/*
+	 * Page-directory table.
+	 */
+	ptr = (uint32_t *)(cr3 & pg_cr3_mask);
+
+	if (ptr[offset] != 0)
+		return 1;
+
+	page = (uint32_t)(addr & 0xFFC00000);
+	page_bits |= 0x80;
+
+	if ((type & pg_readonly) != 0)
+		page_bits &= 0xFFD;
+
+	if ((type & pg_arctic) != 0)
+		page_bits |= 0x800;
+
+	ptr[offset] = page | page_bits;
+
+	return 0;
+}
+
 static const phys_addr_t pg_mega_size = 0x400000;
+static const int pg_mega_order = 10;
 
 #endif
 
 #ifdef DANCY_64
 
 static const cpu_native_t pg_cr3_mask = (cpu_native_t)(0xFFFFFFFFFFFFF000ull);
+static const cpu_native_t pg_cr3_noflush = (cpu_native_t)(1ull << 63);
 
 static uint64_t pg_alloc_static_page(void)
 {
@@ -296,20 +409,18 @@ static void *pg_create_cr3(void)
 	if ((pml4e = (uint64_t *)mm_alloc_pages(mm_addr32, 0)) == NULL)
 		return NULL;
 
-	if ((pdpe = (uint64_t *)mm_alloc_page()) == NULL) {
+	if ((pdpe = (uint64_t *)mm_alloc_zero_page()) == NULL) {
 		mm_free_page((phys_addr_t)pml4e);
 		return NULL;
 	}
 
-	if ((pde = (uint64_t *)mm_alloc_page()) == NULL) {
+	if ((pde = (uint64_t *)mm_alloc_zero_page()) == NULL) {
 		mm_free_page((phys_addr_t)pdpe);
 		mm_free_page((phys_addr_t)pml4e);
 		return NULL;
 	}
 
 	memset(pml4e, 0, 0x1000);
-	memset(pdpe, 0, 0x1000);
-	memset(pde, 0, 0x1000);
 
 	memcpy(pde, pg_kernel_pde, 1024);
 
@@ -334,6 +445,10 @@ static int pg_free_pte(uint64_t *pte, int sync_arctic)
 			r += 1;
 			continue;
 		}
+		if ((pte[i] & 0x600) != 0) {
+			pte[i] = 0;
+			continue;
+		}
 		p = (phys_addr_t)pte[i], pte[i] = 0;
 		p &= 0x000FFFFFFFFFF000ull;
 		mm_free_page(p);
@@ -343,6 +458,42 @@ static int pg_free_pte(uint64_t *pte, int sync_arctic)
 	return r;
 }
 
+static void pg_free_large(uint64_t *pde, int sync_arctic)
+{
+	phys_addr_t p;
+
+	if (sync_arctic && (*pde & 0x800) != 0) {
+		*pde ^= 0x800;
+		return;
+	}
+
+	p = (phys_addr_t)(*pde & 0x000FFFFFFFE00000ull), *pde = 0;
+	mm_free_pages(p, 9);
+	task_current()->pg_user_memory -= 0x200000;
+}
+
+static int pg_split_large(uint64_t *pde)
+{
+	uint64_t page = *pde & 0x000FFFFFFFE00000ull;
+	uint64_t page_bits = *pde & 0xFFF0000000000F7Full;
+	uint64_t *pte;
+	int i;
+
+	/*
+	 * The 2 MiB page is replaced with a page table that maps the
+	 * same physical pages. The bit 7 (PS) is PAT in the entries.
+	 */
+	if ((pte = (uint64_t *)mm_alloc_page()) == NULL)
+		return 1;
+
+	for (i = 0; i < 512; i++)
+		pte[i] = (page + (uint64_t)(i * 0x1000)) | page_bits;
+
+	*pde = (uint64_t)pte | 0x27;
+
+	return 0;
+}
+
 static void pg_delete_cr3(cpu_native_t cr3, int sync_arctic)
 {
 	const uint64_t entry_mask = 0x000FFFFFFFFFF000ull;
@@ -377,8 +528,10 @@ static void pg_delete_cr3(cpu_native_t cr3, int sync_arctic)
 			for (k = (j > 0 ? 0 : 128); k < 512; k++) {
 				if ((pde[k] & 0x01) == 0)
 					continue;
-				if ((pde[k] & 0x80) != 0)
+				if ((pde[k] & 0x80) != 0) {
+					pg_free_large(&pde[k], sync_arctic);
 					continue;
+				}
 				/*
 				 * Page table.
 				 */
@@ -586,9 +739,8 @@ static int pg_map_virtual(cpu_native_t cr3,
 	ptr = (uint64_t *)(cr3 & pg_cr3_mask);
 
 	if ((ptr[pml4e_offset] & 1) == 0) {
-		if ((page = (uint64_t)mm_alloc_page()) == 0)
+		if ((page = (uint64_t)mm_alloc_zero_page()) == 0)
 			return 1;
-		memset((void *)page, 0, 0x1000);
 		ptr[pml4e_offset] = page | page_bits;
 	}
 
@@ -598,9 +750,8 @@ static int pg_map_virtual(cpu_native_t cr3,
 	ptr = (uint64_t *)(ptr[pml4e_offset] & 0xFFFFFFFFFFFFF000ull);
 
 	if ((ptr[pdpe_offset] & 1) == 0) {
-		if ((page = (uint64_t)mm_alloc_page()) == 0)
+		if ((page = (uint64_t)mm_alloc_zero_page()) == 0)
 			return 1;
-		memset((void *)page, 0, 0x1000);
 		ptr[pdpe_offset] = page | page_bits;
 
 	} else if ((ptr[pdpe_offset] & 0x80) != 0) {
@@ -613,13 +764,13 @@ static int pg_map_virtual(cpu_native_t cr3,
 	ptr = (uint64_t *)(ptr[pdpe_offset] & 0xFFFFFFFFFFFFF000ull);
 
 	if ((ptr[offset] & 1) == 0) {
-		if ((page = (uint64_t)mm_alloc_page()) == 0)
+		if ((page = (uint64_t)mm_alloc_zero_page()) == 0)
 			return 1;
-		memset((void *)page, 0, 0x1000);
 		ptr[offset] = page | page_bits;
 
 	} else if ((ptr[offset] & 0x80) != 0) {
-		return 1;
+		if ((ptr[offset] & 0x04) == 0 || pg_split_large(&ptr[offset]))
+			return 1;
 	}
 
 	/*
@@ -642,7 +793,16 @@ static int pg_map_virtual(cpu_native_t cr3,
 	if ((type & pg_noexec) != 0 && kernel->cpu_feature.nxbit != 0)
 		page_bits |= 0x8000000000000000ull;
 
-	if (ptr[offset] == 0) {
+	if ((type & pg_lazy) != 0)
+		page = 0, page_bits = (page_bits & ~1ull) | 0x200;
+
+	if ((type & pg_lazy) != 0 && (type & pg_blocked) != 0)
+		page_bits |= 0x400;
+
+	if ((type & pg_shared) != 0)
+		page_bits = (page_bits & ~2ull) | 0x400;
+
+	if (ptr[offset] == 0 || (ptr[offset] & 0x600) != 0) {
 		ptr[offset] = page | page_bits;
 	} else {
 		uint64_t old_page = ptr[offset] & 0x000FFFFFFFFFF000ull;
@@ -698,7 +858,108 @@ void *pg_get_entry(cpu_native_t cr3, const void *pte)
 	return &ptr[offset];
 }
 
+static void *pg_get_large(cpu_native_t cr3, const void *pte)
+{
+	addr_t addr = (addr_t)pte;
+	int pml4e_offset = (int)(addr >> 39);
+	int pdpe_offset = (int)((addr >> 30) & 0x1FF);
+	int offset = (int)((addr >> 21) & 0x1FF);
+	uint64_t *ptr;
+
+	if (pml4e_offset > 0xFF)
+		return NULL;
+
+	/*
+	 * Page-map-level-4 table.
+	 */
+	ptr = (uint64_t *)(cr3 & pg_cr3_mask);
+
+	if ((ptr[pml4e_offset] & 1) == 0)
+		return NULL;
+
+	/*
+	 * Page-directory-pointer table.
+	 */
+	ptr = (uint64_t *)(ptr[pml4e_offset] & 0xFFFFFFFFFFFFF000ull);
+
+	if ((ptr[pdpe_offset] & 1) == 0 || (ptr[pdpe_offset] & 0x80) != 0)
+		return NULL;
+
+	/*
+	 * Page-directory table.
+	 */
+	ptr = (uint64_t *)(ptr[pdpe_offset] & 0xFFFFFFFFFFFFF000ull);
+
+	if ((ptr[offset] & 0x85) != 0x85)
+		return NULL;
+
+	return &ptr[offset];
+}
+
+static int pg_map_large(cpu_native_t cr3,
+	addr_t vaddr, phys_addr_t addr, int type)
+{
+	uint64_t page_bits = 0x27;
+	int pml4e_offset = (int)(vaddr >> 39);
+	int pdpe_offset = (int)((vaddr >> 30) & 0x1FF);
+	int offset = (int)((vaddr >> 21) & 0x1FF);
+	uint64_t page, *ptr;
+
+	if (pml4e_offset > 0xFF)
+		return 1;
+
+	/*
+	 * Page-map-level-4 table.
+	 */
+	ptr = (uint64_t *)(cr3 & pg_cr3_mask);
+
+	if ((ptr[pml4e_offset] & 1) == 0) {
+		if ((page = (uint64_t)mm_alloc_zero_page()) == 0)
+			return 1;
+		ptr[pml4e_offset] = page | page_bits;
+	}
+
+	/*
+	 * Page-directory-pointer table.
+	 */
+	ptr = (uint64_t *)(ptr[pml4e_offset] & 0xFFFFFFFFFFFFF000ull);
+
+	if ((ptr[pdpe_offset] & 1) == 0) {
+		if ((page = (uint64_t)mm_alloc_zero_page()) == 0)
+			return 1;
+		ptr[pdpe_offset] = page | page_bits;
+
+	} else if ((ptr[pdpe_offset] & 0x80) != 0) {
+		return 1;
+	}
+
+	/*
+	 * Page-directory table.
+	 */
+	ptr = (uint64_t *)(ptr[pdpe_offset] & 0xFFFFFFFFFFFFF000ull);
+
+	if (ptr[offset] != 0)
+		return 1;
+
+	page = (uint64_t)(addr & 0xFFFFFFFFFFE00000ull);
+	page_bits |= 0x80;
+
+	if ((type & pg_readonly) != 0)
+		page_bits &= 0xFFD;
+
+	if ((type & pg_arctic) != 0)
+		page_bits |= 0x800;
+
+	if ((type & pg_noexec) != 0 && kernel->cpu_feature.nxbit != 0)
+		page_bits |= 0x8000000000000000ull;
+
+	ptr[offset] = page | page_bits;
+
+	return 0;
+}
+
 static const phys_addr_t pg_mega_size = 0x200000;
+static const int pg_mega_order = 9;
 static const phys_addr_t pg_giga_size = 0x40000000;
 
 #endif
@@ -810,17 +1071,13 @@ int pg_init(void)
 	}
 
 	/*
-	 * Map the framebuffer (4 KiB pages).
+	 * Map the framebuffer (large pages if aligned).
 	 */
 	{
 		size_t size = (size_t)(kernel->fb_height * kernel->fb_stride);
-		int map_count = (int)((size + 0x0FFF) / 0x1000);
 		phys_addr_t addr = kernel->fb_addr;
 
-		for (i = 0; i < map_count; i++) {
-			pg_map_kernel(addr, 0x1000, pg_normal);
-			addr += 0x1000;
-		}
+		pg_map_kernel(addr, size, pg_normal);
 	}
 
 	/*
@@ -896,10 +1153,25 @@ int pg_init(void)
 			return DE_MEMORY;
 	}
 
+#ifdef DANCY_64
+	if (kernel->cpu_feature.pcid) {
+		int count = kernel->smp_ap_count + 1;
+		size_t size = (size_t)count * sizeof(*pg_pcid_owner);
+
+		if ((pg_pcid_owner = malloc(size)) == NULL)
+			return DE_MEMORY;
+
+		memset(pg_pcid_owner, 0, size);
+		pg_pcid_count = count;
+	}
+#endif
 	r = cpu_ints(0);
 	cpu_write_cr4(cpu_read_cr4() | (1u << 7) | (1u << 4));
 	cpu_write_cr3(pg_kernel);
 
+	if (pg_pcid_count != 0)
+		cpu_write_cr4(cpu_read_cr4() | (1u << 17));
+
 	/*
 	 * Update the timer interrupt handler (I/O APIC)
 	 * and restore the interrupt flag.
@@ -936,11 +1208,109 @@ int pg_init_ap(void)
 	cpu_write_cr4(cpu_read_cr4() | (1u << 7) | (1u << 4));
 	cpu_write_cr3(pg_kernel);
 
+	if (pg_pcid_count != 0)
+		cpu_write_cr4(cpu_read_cr4() | (1u << 17));
+
 	cpu_ints(r);
 
 	return 0;
 }
 
+static void pg_load_user(struct task *current, cpu_native_t cr3)
+{
+	int r = cpu_ints(0);
+
+	/*
+	 * The translations of the user address space are not flushed if
+	 * the same address space was loaded last on this processor and
+	 * the page tables have not been modified after that.
+	 */
+	if (pg_pcid_count != 0) {
+		uint32_t generation = current->pg_generation;
+		cpu_native_t noflush = 0;
+		int cpu = gdt_get_cpu();
+
+		cr3 |= 1;
+
+		if (cpu >= 0 && cpu < pg_pcid_count) {
+			if (pg_pcid_owner[cpu].cr3 == cr3) {
+				if (pg_pcid_owner[cpu].generation == generation)
+					noflush = pg_cr3_noflush;
+			}
+
+			pg_pcid_owner[cpu].cr3 = cr3;
+			pg_pcid_owner[cpu].generation = generation;
+		}
+
+		current->cr3 = (uint32_t)cr3;
+		cpu_write_cr3(cr3 | noflush);
+
+		cpu_ints(r);
+		return;
+	}
+
+	current->cr3 = (uint32_t)cr3;
+	cpu_write_cr3(cr3);
+
+	cpu_ints(r);
+}
+
+static void pg_forget_user(cpu_native_t cr3)
+{
+	int i;
+
+	for (i = 0; i < pg_pcid_count; i++) {
+		if (pg_pcid_owner[i].cr3 == (cr3 | 1))
+			pg_pcid_owner[i].cr3 = 0;
+	}
+}
+
+void pg_switch_user(struct task *next)
+{
+	cpu_native_t cr3 = (cpu_native_t)next->cr3;
+	int cpu;
+
+	/*
+	 * The task switch loads the address space without preserving
+	 * the translations, so the next task owns the identifier 1.
+	 */
+	if (pg_pcid_count == 0 || (cr3 & 1) == 0)
+		return;
+
+	if ((cpu = gdt_get_cpu()) >= 0 && cpu < pg_pcid_count) {
+		pg_pcid_owner[cpu].cr3 = cr3;
+		pg_pcid_owner[cpu].generation = next->pg_generation;
+	}
+}
+
+void pg_invalidate_page(const void *vaddr)
+{
+	/*
+	 * Invalidate the translations of both identifiers.
+	 */
+	if (pg_pcid_count != 0) {
+		cpu_native_t descriptor[2];
+
+		descriptor[0] = 0;
+		descriptor[1] = (cpu_native_t)vaddr;
+		cpu_invpcid(0, &descriptor[0]);
+
+		descriptor[0] = 1;
+		cpu_invpcid(0, &descriptor[0]);
+		return;
+	}
+
+	cpu_invlpg(vaddr);
+}
+
+static void pg_release_image(struct coff_image **image)
+{
+	struct coff_image *i = *image;
+
+	if (i != NULL)
+		*image = NULL, coff_release_image(i);
+}
+
 int pg_create(void)
 {
 	struct task *current = task_current();
@@ -953,8 +1323,7 @@ int pg_create(void)
 		return DE_MEMORY;
 
 	current->pg_cr3 = (uint32_t)cr3;
-	current->cr3 = (uint32_t)cr3;
-	cpu_write_cr3(cr3);
+	pg_load_user(current, cr3);
 
 	return 0;
 }
@@ -971,12 +1340,19 @@ void pg_delete(void)
 	current->cr3 = (uint32_t)pg_kernel;
 	cpu_write_cr3(pg_kernel);
 
+	pg_file_release(&current->pg_maps, cr3);
+	pg_forget_user(cr3);
 	pg_delete_cr3(cr3, 0);
 
 	if ((cr3 = (cpu_native_t)current->pg_alt_cr3) != 0) {
 		current->pg_alt_cr3 = 0;
+		pg_file_release(&current->pg_alt_maps, cr3);
+		pg_forget_user(cr3);
 		pg_delete_cr3(cr3, 0);
 	}
+
+	pg_release_image(&current->pg_image);
+	pg_release_image(&current->pg_alt_image);
 }
 
 void pg_sync_arctic(void)
@@ -988,6 +1364,7 @@ void pg_sync_arctic(void)
 
 	pg_enter_kernel();
 	pg_delete_cr3(cr3, 1);
+	task_current()->pg_generation += 1;
 	pg_leave_kernel();
 }
 
@@ -1001,6 +1378,11 @@ void pg_enter_kernel(void)
 	if ((cpu_read_cr3() & pg_cr3_mask) == pg_kernel)
 		return;
 
+	if (pg_pcid_count != 0) {
+		cpu_write_cr3(pg_kernel | pg_cr3_noflush);
+		return;
+	}
+
 	cpu_write_cr3(pg_kernel);
 }
 
@@ -1015,8 +1397,7 @@ void pg_leave_kernel(void)
 	if ((cr3 = (cpu_native_t)current->pg_cr3) == 0)
 		return;
 
-	current->cr3 = (uint32_t)cr3;
-	cpu_write_cr3(cr3);
+	pg_load_user(current, cr3);
 }
 
 int pg_alt_create(void)
@@ -1036,8 +1417,13 @@ int pg_alt_create(void)
 
 	current->pg_alt_cr3 = current->pg_cr3;
 	current->pg_cr3 = (uint32_t)cr3;
-	current->cr3 = (uint32_t)cr3;
-	cpu_write_cr3(cr3);
+	pg_load_user(current, cr3);
+
+	current->pg_alt_image = current->pg_image;
+	current->pg_image = NULL;
+
+	current->pg_alt_maps = current->pg_maps;
+	current->pg_maps = NULL;
 
 	return 0;
 }
@@ -1048,7 +1434,7 @@ void pg_alt_accept(void)
 	cpu_native_t cr3[2];
 
 	cr3[0] = (cpu_native_t)current->pg_alt_cr3;
-	cr3[1] = cpu_read_cr3();
+	cr3[1] = cpu_read_cr3() & pg_cr3_mask;
 
 	if (!cr3[0] || current->pg_cr3 != cr3[1])
 		return;
@@ -1056,8 +1442,12 @@ void pg_alt_accept(void)
 	current->pg_alt_cr3 = 0;
 
 	pg_enter_kernel();
+	pg_file_release(&current->pg_alt_maps, cr3[0]);
+	pg_forget_user(cr3[0]);
 	pg_delete_cr3(cr3[0], 0);
 	pg_leave_kernel();
+
+	pg_release_image(&current->pg_alt_image);
 }
 
 void pg_alt_delete(void)
@@ -1066,7 +1456,7 @@ void pg_alt_delete(void)
 	cpu_native_t cr3[2];
 
 	cr3[0] = (cpu_native_t)current->pg_alt_cr3;
-	cr3[1] = cpu_read_cr3();
+	cr3[1] = cpu_read_cr3() & pg_cr3_mask;
 
 	if (!cr3[0] || current->pg_cr3 != cr3[1])
 		return;
@@ -1075,8 +1465,17 @@ void pg_alt_delete(void)
 	current->pg_alt_cr3 = 0;
 
 	pg_enter_kernel();
+	pg_file_release(&current->pg_maps, cr3[1]);
+	pg_forget_user(cr3[1]);
 	pg_delete_cr3(cr3[1], 0);
 	pg_leave_kernel();
+
+	pg_release_image(&current->pg_image);
+	current->pg_image = current->pg_alt_image;
+	current->pg_alt_image = NULL;
+
+	current->pg_maps = current->pg_alt_maps;
+	current->pg_alt_maps = NULL;
 }
 
 void *pg_map_kernel(phys_addr_t addr, size_t size, int type)
@@ -1143,6 +1542,35 @@ void *pg_map_kernel(phys_addr_t addr, size_t size, int type)
 	return (void *)addr;
 }
 
+static int pg_map_user_large(cpu_native_t cr3,
+	addr_t vaddr_beg, addr_t vaddr_end, int type)
+{
+	const addr_t mega_mask = (addr_t)(pg_mega_size - 1);
+	phys_addr_t addr;
+
+	if ((type & pg_large) == 0 || (type & pg_blocked) != 0)
+		return 0;
+
+	if ((vaddr_end & mega_mask) != 0)
+		return 0;
+
+	if ((vaddr_end - vaddr_beg) < (addr_t)pg_mega_size)
+		return 0;
+
+	if ((addr = mm_alloc_pages(mm_normal, pg_mega_order)) == 0)
+		return 0;
+
+	if (pg_map_large(cr3, vaddr_end - (addr_t)pg_mega_size, addr, type)) {
+		mm_free_pages(addr, pg_mega_order);
+		return 0;
+	}
+
+	memset((void *)addr, 0, (size_t)pg_mega_size);
+	task_current()->pg_user_memory += (cpu_native_t)pg_mega_size;
+
+	return 1;
+}
+
 void *pg_map_user(addr_t vaddr, size_t size, int type)
 {
 	const addr_t page_mask = 0x0FFF;
@@ -1169,13 +1597,42 @@ void *pg_map_user(addr_t vaddr, size_t size, int type)
 
 	pg_enter_kernel();
 
+	/*
+	 * The lazy pages are only reserved. The page table entries are
+	 * not present and have bit 9 set (bit 10 if also blocked), and
+	 * the zeroed pages are allocated when the pages are accessed.
+	 * Bit 10 without bit 9 means a shared page that is not owned
+	 * by the address space (see pg_share_user).
+	 *
+	 * The large pages (pg_large) are never lazy. They are used for
+	 * the aligned parts of the range if the page directory entries
+	 * are not in use and the physical memory is available.
+	 */
+	while ((vaddr_end - vaddr_beg) != 0 && (type & pg_lazy) != 0) {
+		if (pg_map_user_large(cr3, vaddr_beg, vaddr_end, type)) {
+			vaddr_end -= (addr_t)pg_mega_size;
+			continue;
+		}
+
+		vaddr_end -= 0x1000;
+
+		if (pg_map_virtual(cr3, vaddr_end, 0, type)) {
+			vaddr = 0;
+			break;
+		}
+	}
+
 	while ((vaddr_end - vaddr_beg) != 0) {
-		if ((addr = mm_alloc_page()) == 0) {
+		if (pg_map_user_large(cr3, vaddr_beg, vaddr_end, type)) {
+			vaddr_end -= (addr_t)pg_mega_size;
+			continue;
+		}
+
+		if ((addr = mm_alloc_zero_page()) == 0) {
 			vaddr = 0;
 			break;
 		}
 
-		memset((void *)addr, 0, 0x1000);
 		current->pg_user_memory += 0x1000;
 		vaddr_end -= 0x1000;
 
@@ -1187,6 +1644,7 @@ void *pg_map_user(addr_t vaddr, size_t size, int type)
 		}
 	}
 
+	current->pg_generation += 1;
 	pg_leave_kernel();
 
 	return (void *)vaddr;
@@ -1195,8 +1653,10 @@ void *pg_map_user(addr_t vaddr, size_t size, int type)
 int pg_unmap_user(addr_t vaddr, size_t size)
 {
 	const addr_t page_mask = 0x0FFF;
+	const addr_t mega_mask = (addr_t)(pg_mega_size - 1);
 	addr_t vaddr_beg, vaddr_end;
 	phys_addr_t addr;
+	int r = 0;
 
 	struct task *current = task_current();
 	cpu_native_t cr3 = cpu_read_cr3();
@@ -1219,13 +1679,37 @@ int pg_unmap_user(addr_t vaddr, size_t size)
 	pg_enter_kernel();
 
 	while ((vaddr_end - vaddr_beg) != 0) {
-		cpu_native_t *e = pg_get_entry(cr3, (const void *)vaddr_beg);
+		void *large = pg_get_large(cr3, (const void *)vaddr_beg);
+		cpu_native_t *e;
+
+		/*
+		 * The large pages are released if they are completely
+		 * in the range. Otherwise, they are split first.
+		 */
+		if (large != NULL && (vaddr_beg & mega_mask) == 0) {
+			if ((vaddr_end - vaddr_beg) >= (addr_t)pg_mega_size) {
+				pg_free_large(large, 0);
+				vaddr_beg += (addr_t)pg_mega_size;
+				continue;
+			}
+		}
 
+		if (large != NULL && pg_split_large(large)) {
+			r = DE_MEMORY;
+			break;
+		}
+
+		e = pg_get_entry(cr3, (const void *)vaddr_beg);
 		vaddr_beg += 0x1000;
 
 		if (e == NULL || (*e & 0x04) != 0x04)
 			continue;
 
+		if ((*e & 0x600) != 0) {
+			*e = (cpu_native_t)(0);
+			continue;
+		}
+
 		addr = (phys_addr_t)(*e & (~page_mask));
 		*e = (cpu_native_t)(0);
 
@@ -1233,9 +1717,111 @@ int pg_unmap_user(addr_t vaddr, size_t size)
 		current->pg_user_memory -= 0x1000;
 	}
 
+	current->pg_generation += 1;
 	pg_leave_kernel();
 
-	return 0;
+	return r;
+}
+
+void *pg_map_shared(addr_t vaddr, size_t size,
+	const phys_addr_t *pages, int type)
+{
+	const addr_t page_mask = 0x0FFF;
+	addr_t vaddr_beg, vaddr_end;
+
+	struct task *current = task_current();
+	cpu_native_t cr3 = cpu_read_cr3();
+	int i;
+
+	if ((cr3 & pg_cr3_mask) == pg_kernel)
+		return NULL;
+
+	if (cr3 != (cpu_native_t)current->cr3)
+		return NULL;
+
+	if (size == 0 || vaddr < 0x10000000 || (vaddr & page_mask) != 0)
+		return NULL;
+
+	if ((vaddr > (SIZE_MAX - size) + 1))
+		return NULL;
+
+	vaddr_beg = vaddr;
+	vaddr_end = ((addr_t)(vaddr + size) + page_mask) & (~page_mask);
+
+	type = (type & (~((int)pg_lazy))) | pg_shared;
+
+	pg_enter_kernel();
+
+	for (i = 0; (vaddr_end - vaddr_beg) != 0; i++) {
+		if (pg_map_virtual(cr3, vaddr_beg, pages[i], type)) {
+			vaddr = 0;
+			break;
+		}
+		vaddr_beg += 0x1000;
+	}
+
+	current->pg_generation += 1;
+	pg_leave_kernel();
+
+	return (void *)vaddr;
+}
+
+int pg_share_user(addr_t vaddr, size_t size, phys_addr_t *pages)
+{
+	const addr_t page_mask = 0x0FFF;
+	addr_t vaddr_beg, vaddr_end, a;
+
+	struct task *current = task_current();
+	cpu_native_t cr3 = cpu_read_cr3();
+	int i, r = 0;
+
+	if ((cr3 & pg_cr3_mask) == pg_kernel)
+		return DE_ARGUMENT;
+
+	if (cr3 != (cpu_native_t)current->cr3)
+		return DE_ARGUMENT;
+
+	if (size == 0 || vaddr < 0x10000000 || (vaddr & page_mask) != 0)
+		return DE_ARGUMENT;
+
+	if ((vaddr > (SIZE_MAX - size) + 1))
+		return DE_ARGUMENT;
+
+	vaddr_beg = vaddr;
+	vaddr_end = ((addr_t)(vaddr + size) + page_mask) & (~page_mask);
+
+	pg_enter_kernel();
+
+	/*
+	 * All the pages must be present and owned by the address space.
+	 */
+	for (a = vaddr_beg; a != vaddr_end && r == 0; a += 0x1000) {
+		cpu_native_t *e = pg_get_entry(cr3, (const void *)a);
+
+		if (e == NULL || (*e & 0x605) != 0x005)
+			r = DE_ADDRESS;
+	}
+
+	/*
+	 * The ownership of the pages is given to the caller. The pages
+	 * are not released when the address space is deleted.
+	 */
+	for (a = vaddr_beg, i = 0; a != vaddr_end && r == 0; a += 0x1000) {
+		cpu_native_t *e = pg_get_entry(cr3, (const void *)a);
+		phys_addr_t addr = (phys_addr_t)(*e & (~page_mask));
+#ifdef DANCY_64
+		addr &= 0x000FFFFFFFFFF000ull;
+#endif
+		pages[i++] = addr;
+
+		*e = (*e & (~((cpu_native_t)0x002))) | 0x400;
+		current->pg_user_memory -= 0x1000;
+	}
+
+	current->pg_generation += 1;
+	pg_leave_kernel();
+
+	return r;
 }
 
 uint64_t pg_read_memory(phys_addr_t addr, size_t size)
@@ -1257,7 +1843,7 @@ uint64_t pg_read_memory(phys_addr_t addr, size_t size)
 	spin_enter(&lock_local);
 
 	*entry = (*entry & page_mask) | page_addr;
-	cpu_invlpg((const void *)access_vaddr);
+	pg_invalidate_page((const void *)access_vaddr);
 
 	if (size == 1)
 		r = (uint64_t)cpu_read8((const void *)access_vaddr);
@@ -1294,7 +1880,7 @@ void pg_write_memory(phys_addr_t addr, uint64_t val, size_t size)
 	spin_enter(&lock_local);
 
 	*entry = (*entry & page_mask) | page_addr;
-	cpu_invlpg((const void *)access_vaddr);
+	pg_invalidate_page((const void *)access_vaddr);
 
 	if (size == 1)
 		cpu_write8((void *)access_vaddr, (uint8_t)val);
@@ -1311,18 +1897,20 @@ void pg_write_memory(phys_addr_t addr, uint64_t val, size_t size)
 	spin_leave(&lock_local);
 }
 
-void pg_protect_user(addr_t vaddr, size_t size, int type)
+int pg_protect_user(addr_t vaddr, size_t size, int type)
 {
 	const addr_t mask = (addr_t)0x0FFF;
 	const addr_t add  = (addr_t)0x1000;
+	const addr_t mega_mask = (addr_t)(pg_mega_size - 1);
 
 	addr_t a = vaddr;
 	addr_t e = vaddr + (addr_t)((size > 0) ? size - 1 : 0);
 
 	cpu_native_t cr3 = cpu_read_cr3();
+	int r = 0;
 
 	if (size == 0 || a < 0x10000000 || a > e)
-		return;
+		return 0;
 
 	a &= (~mask);
 	e &= (~mask);
@@ -1331,7 +1919,43 @@ void pg_protect_user(addr_t vaddr, size_t size, int type)
 	pg_enter_kernel();
 
 	do {
-		cpu_native_t *p = pg_get_entry(cr3, (const void *)a);
+		void *large = pg_get_large(cr3, (const void *)a);
+		cpu_native_t *p;
+
+		/*
+		 * The protection of a large page is changed directly if
+		 * the page is completely in the range and not blocked.
+		 * Otherwise, the large page is split.
+		 */
+		if (large != NULL && (a & mega_mask) == 0) {
+			int whole = ((e - a) >= (addr_t)pg_mega_size);
+
+			if (whole && (type & pg_blocked) == 0) {
+				cpu_native_t *pde = large;
+				cpu_native_t v = (*pde | 0x002);
+
+				if ((type & pg_readonly) != 0)
+					v ^= 0x002;
+#ifdef DANCY_64
+				v &= 0x7FFFFFFFFFFFFFFFull;
+
+				if ((type & pg_noexec) != 0) {
+					if (kernel->cpu_feature.nxbit != 0)
+						v |= 0x8000000000000000ull;
+				}
+#endif
+				*pde = v;
+				a += (addr_t)pg_mega_size;
+				continue;
+			}
+		}
+
+		if (large != NULL && pg_split_large(large)) {
+			r = DE_MEMORY;
+			break;
+		}
+
+		p = pg_get_entry(cr3, (const void *)a);
 
 		if (p != NULL && (*p & 0x004) != 0) {
 			cpu_native_t v = (*p | 0x003);
@@ -1341,6 +1965,16 @@ void pg_protect_user(addr_t vaddr, size_t size, int type)
 
 			if ((type & pg_readonly) != 0)
 				v ^= 0x002;
+
+			if ((v & 0x200) != 0) {
+				v &= (~((cpu_native_t)0x401));
+
+				if ((type & pg_blocked) != 0)
+					v |= 0x400;
+
+			} else if ((v & 0x400) != 0) {
+				v &= (~((cpu_native_t)0x002));
+			}
 #ifdef DANCY_64
 			v &= 0x7FFFFFFFFFFFFFFFull;
 
@@ -1356,7 +1990,59 @@ void pg_protect_user(addr_t vaddr, size_t size, int type)
 
 	} while (a != e);
 
+	task_current()->pg_generation += 1;
 	pg_leave_kernel();
+
+	return r;
+}
+
+static int pg_demand_zero(cpu_native_t *e, addr_t vaddr)
+{
+	phys_addr_t addr;
+	int r;
+
+	if ((*e & 0x605) != (0x200 | 0x004))
+		return DE_ACCESS;
+
+	if ((addr = mm_alloc_zero_page()) == 0)
+		return DE_MEMORY;
+
+	if ((r = pg_file_fill(vaddr, (void *)addr)) != 0) {
+		mm_free_page(addr);
+		return r;
+	}
+
+	task_current()->pg_user_memory += 0x1000;
+
+	*e = (*e ^ 0x200) | (cpu_native_t)addr | 0x021;
+
+	return 0;
+}
+
+int pg_fault_user(addr_t vaddr)
+{
+	struct task *current = task_current();
+	cpu_native_t cr3 = cpu_read_cr3();
+	cpu_native_t *e;
+	int r = DE_ADDRESS;
+
+	if ((cr3 & pg_cr3_mask) == pg_kernel)
+		return DE_ARGUMENT;
+
+	if (cr3 != (cpu_native_t)current->cr3)
+		return DE_ARGUMENT;
+
+	if (vaddr < 0x10000000)
+		return DE_ARGUMENT;
+
+	pg_enter_kernel();
+
+	if ((e = pg_get_entry(cr3, (const void *)vaddr)) != NULL)
+		r = pg_demand_zero(e, vaddr);
+
+	pg_leave_kernel();
+
+	return r;
 }
 
 static int pg_check_user(cpu_native_t cr3, addr_t vaddr, size_t size, int rw)
@@ -1377,6 +2063,16 @@ static int pg_check_user(cpu_native_t cr3, addr_t vaddr, size_t size, int rw)
 	do {
 		unsigned int *p = pg_get_entry(cr3, (const void *)a);
 
+		if (p == NULL)
+			p = pg_get_large(cr3, (const void *)a);
+
+		if (p != NULL && (*p & 0x201u) == 0x200u) {
+			int r = pg_demand_zero((cpu_native_t *)((void *)p), a);
+
+			if (r != 0)
+				return (r == DE_ACCESS) ? r : DE_ADDRESS;
+		}
+
 		if (p == NULL || (*p & 1u) == 0) {
 			const addr_t stack_min = 0x78000000;
 			const addr_t stack_max = 0x7FFFFFFF;
@@ -1388,10 +2084,9 @@ static int pg_check_user(cpu_native_t cr3, addr_t vaddr, size_t size, int rw)
 			if (a < stack_min || a > stack_max)
 				return DE_ADDRESS;
 
-			if ((addr = mm_alloc_page()) == 0)
+			if ((addr = mm_alloc_zero_page()) == 0)
 				return DE_ADDRESS;
 
-			memset((void *)addr, 0, 0x1000);
 			task_current()->pg_user_memory += 0x1000;
 
 			if (pg_map_virtual(cr3, a, addr, pg_noexec)) {
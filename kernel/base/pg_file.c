@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * base/pg_file.c
+ *      File-backed memory mappings
+ */
+
+#include <dancy.h>
+
+/*
+ * The file mappings are reserved like the lazy anonymous mappings, and
+ * the pages are read from the file when they are accessed. The dirty
+ * pages of the shared mappings are written back to the file when the
+ * mappings are synchronized, unmapped, or deleted.
+ */
+struct pg_file_map {
+	struct pg_file_map *next;
+
+	addr_t vaddr;
+	size_t size;
+	uint64_t offset;
+
+	struct vfs_node *node;
+	int shared;
+};
+
+static const addr_t pg_file_mask = 0x0FFF;
+
+static int pg_file_write(cpu_native_t cr3,
+	struct pg_file_map *map, addr_t beg, addr_t end)
+{
+	struct vfs_node *node = map->node;
+	struct vfs_stat stat;
+	addr_t a;
+	int r;
+
+	if (!map->shared || cr3 == 0)
+		return 0;
+
+	if ((r = node->n_stat(node, &stat)) != 0)
+		return r;
+
+	for (a = beg; a < end; a += 0x1000) {
+		uint64_t offset = map->offset + (uint64_t)(a - map->vaddr);
+		size_t size = 0x1000;
+		cpu_native_t *e;
+		phys_addr_t addr;
+
+		if (offset >= stat.size)
+			break;
+
+		if (stat.size - offset < (uint64_t)size)
+			size = (size_t)(stat.size - offset);
+
+		pg_enter_kernel();
+
+		/*
+		 * Only the present pages that are dirty (bit 6) and owned
+		 * by the address space are written.
+		 */
+		e = pg_get_entry(cr3, (const void *)a);
+
+		if (e == NULL || (*e & 0x645) != 0x045) {
+			pg_leave_kernel();
+			continue;
+		}
+
+		addr = (phys_addr_t)(*e & (~((cpu_native_t)pg_file_mask)));
+#ifdef DANCY_64
+		addr &= 0x000FFFFFFFFFF000ull;
+#endif
+		r = node->n_write(node, offset, &size, (const void *)addr);
+
+		if (r == 0) {
+			*e &= (~((cpu_native_t)0x040));
+			task_current()->pg_generation += 1;
+		}
+
+		pg_leave_kernel();
+
+		if (r != 0)
+			return r;
+	}
+
+	return 0;
+}
+
+int pg_file_map(addr_t vaddr, size_t size,
+	struct vfs_node *node, uint64_t offset, int type, int shared)
+{
+	struct task *current = task_current();
+	struct pg_file_map *map;
+	int r;
+
+	if (size == 0 || vaddr < 0x10000000)
+		return DE_ARGUMENT;
+
+	if ((vaddr & pg_file_mask) != 0 || (offset & pg_file_mask) != 0)
+		return DE_ALIGNMENT;
+
+	if ((vaddr > (SIZE_MAX - size) + 1))
+		return DE_ARGUMENT;
+
+	if ((map = malloc(sizeof(*map))) == NULL)
+		return DE_MEMORY;
+
+	if ((r = pg_file_unmap(vaddr, size)) != 0)
+		return free(map), r;
+
+	if ((addr_t)pg_map_user(vaddr, size, type | pg_lazy) != vaddr)
+		return free(map), DE_MEMORY;
+
+	map->vaddr = vaddr;
+	map->size = (size + pg_file_mask) & (~((size_t)pg_file_mask));
+	map->offset = offset;
+
+	vfs_increment_count(node);
+	map->node = node;
+	map->shared = shared;
+
+	map->next = current->pg_maps;
+	current->pg_maps = map;
+
+	return 0;
+}
+
+int pg_file_unmap(addr_t vaddr, size_t size)
+{
+	struct task *current = task_current();
+	cpu_native_t cr3 = (cpu_native_t)current->pg_cr3;
+	struct pg_file_map **link = &current->pg_maps;
+	struct pg_file_map *map;
+	addr_t beg, end;
+	int r = 0;
+
+	if (size == 0 || (vaddr > (SIZE_MAX - size) + 1))
+		return DE_ARGUMENT;
+
+	beg = vaddr & (~pg_file_mask);
+	end = ((addr_t)(vaddr + size) + pg_file_mask) & (~pg_file_mask);
+
+	while ((map = *link) != NULL) {
+		addr_t map_end = map->vaddr + (addr_t)map->size;
+		addr_t a = map->vaddr, b = map_end;
+
+		if (map_end <= beg || map->vaddr >= end) {
+			link = &map->next;
+			continue;
+		}
+
+		a = (a < beg) ? beg : a;
+		b = (b > end) ? end : b;
+
+		/*
+		 * Split the mapping if the range is in the middle. The
+		 * tail is allocated first, so the mapping is not modified
+		 * if the allocation or the write-back fails.
+		 */
+		if (a > map->vaddr && b < map_end) {
+			struct pg_file_map *tail = malloc(sizeof(*tail));
+
+			if (tail == NULL)
+				return DE_MEMORY;
+
+			if (pg_file_write(cr3, map, a, b) != 0) {
+				free(tail);
+				r = DE_WRITE;
+				link = &map->next;
+				continue;
+			}
+
+			memcpy(tail, map, sizeof(*tail));
+			tail->vaddr = b;
+			tail->size = (size_t)(map_end - b);
+			tail->offset += (uint64_t)(b - map->vaddr);
+			vfs_increment_count(tail->node);
+
+			map->size = (size_t)(a - map->vaddr);
+			map->next = tail;
+			link = &tail->next;
+			continue;
+		}
+
+		if (pg_file_write(cr3, map, a, b) != 0) {
+			r = DE_WRITE;
+			link = &map->next;
+			continue;
+		}
+
+		if (a > map->vaddr) {
+			map->size = (size_t)(a - map->vaddr);
+			link = &map->next;
+			continue;
+		}
+
+		if (b < map_end) {
+			map->offset += (uint64_t)(b - map->vaddr);
+			map->size = (size_t)(map_end - b);
+			map->vaddr = b;
+			link = &map->next;
+			continue;
+		}
+
+		*link = map->next;
+		map->node->n_release(&map->node);
+		free(map);
+	}
+
+	return r;
+}
+
+int pg_file_sync(addr_t vaddr, size_t size)
+{
+	struct task *current = task_current();
+	cpu_native_t cr3 = (cpu_native_t)current->pg_cr3;
+	struct pg_file_map *map = current->pg_maps;
+	addr_t beg, end;
+
+	if (size == 0 || (vaddr > (SIZE_MAX - size) + 1))
+		return DE_ARGUMENT;
+
+	beg = vaddr & (~pg_file_mask);
+	end = ((addr_t)(vaddr + size) + pg_file_mask) & (~pg_file_mask);
+
+	while (map != NULL) {
+		addr_t a = map->vaddr;
+		addr_t b = map->vaddr + (addr_t)map->size;
+
+		a = (a < beg) ? beg : a;
+		b = (b > end) ? end : b;
+
+		if (a < b && pg_file_write(cr3, map, a, b) != 0)
+			return DE_WRITE;
+
+		map = map->next;
+	}
+
+	return 0;
+}
+
+int pg_file_fill(addr_t vaddr, void *page)
+{
+	struct pg_file_map *map = task_current()->pg_maps;
+
+	vaddr &= (~pg_file_mask);
+
+	while (map != NULL) {
+		addr_t map_end = map->vaddr + (addr_t)map->size;
+
+		if (vaddr >= map->vaddr && vaddr < map_end) {
+			struct vfs_node *node = map->node;
+			uint64_t offset = map->offset;
+			size_t size = 0x1000;
+
+			offset += (uint64_t)(vaddr - map->vaddr);
+
+			return node->n_read(node, offset, &size, page);
+		}
+
+		map = map->next;
+	}
+
+	return 0;
+}
+
+void pg_file_release(struct pg_file_map **maps, cpu_native_t cr3)
+{
+	struct pg_file_map *map = *maps;
+
+	*maps = NULL;
+
+	while (map != NULL) {
+		struct pg_file_map *next = map->next;
+		addr_t end = map->vaddr + (addr_t)map->size;
+
+		(void)pg_file_write(cr3, map, map->vaddr, end);
+
+		map->node->n_release(&map->node);
+		free(map);
+
+		map = next;
+	}
+}
@@ -86,6 +86,16 @@ static void empty_yield(void)
 	cpu_add32(&empty_yield_count, 1);
 }
 
+static void empty_enqueue(struct task *task)
+{
+	(void)task;
+}
+
+static void empty_preempt(void)
+{
+	return;
+}
+
 void kernel_start(void)
 {
 	static int run_once;
@@ -114,9 +124,12 @@ void kernel_start(void)
 		kernel->panic("SMP: kernel synchronization failure");
 
 	kernel->scheduler.yield = empty_yield;
+	kernel->scheduler.enqueue = empty_enqueue;
+	kernel->scheduler.preempt = empty_preempt;
 
 	checked_init(heap_init, "Heap memory manager");
 	checked_init(gdt_init, "GDT (BSP)");
+	checked_init(heap_init_cpu, "Heap caches");
 	checked_init(idt_init, "IDT (BSP)");
 
 	checked_init(pg_init, "Paging (BSP)");
@@ -130,7 +143,9 @@ void kernel_start(void)
 	kernel->detach_init_module(&timer_ticks);
 
 	checked_init(mm_init, "Physical memory manager");
+	checked_init(timer_init, "Timer");
 	checked_init(task_init, "Task");
+	checked_init(heap_init_blocks, "Heap blocks");
 	checked_init(runlevel_init, "Runlevel");
 
 	/*
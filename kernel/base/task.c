@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021, 2022, 2023, 2024, 2025 Antti Tiihala
+ * Copyright (c) 2021, 2022, 2023, 2024, 2025, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -39,6 +39,76 @@ static struct task *task_pool_head;
 static int task_struct_count;
 static int task_struct_limit;
 
+/*
+ * The task structures on the circular linked list are also indexed by
+ * the task, group, and session identifications. Each index is a hash
+ * table of singly linked lists, and the task_lock protects them.
+ */
+#define TASK_INDEX_ID 0
+#define TASK_INDEX_GROUP 1
+#define TASK_INDEX_SESSION 2
+#define TASK_INDEX_COUNT 3
+#define TASK_INDEX_SIZE 256
+
+static struct task *task_index[TASK_INDEX_COUNT][TASK_INDEX_SIZE];
+
+static uint64_t task_index_key(const struct task *task, int index)
+{
+	if (index == TASK_INDEX_GROUP)
+		return task->id_group;
+
+	if (index == TASK_INDEX_SESSION)
+		return task->id_session;
+
+	return task->id;
+}
+
+static struct task **task_index_head(int index, uint64_t key)
+{
+	return &task_index[index][(size_t)(key % TASK_INDEX_SIZE)];
+}
+
+static void task_index_insert(struct task *task, int index)
+{
+	uint64_t key = task_index_key(task, index);
+	struct task **head = task_index_head(index, key);
+
+	task->index_next[index] = *head;
+	*head = task;
+}
+
+static void task_index_remove(struct task *task, int index)
+{
+	uint64_t key = task_index_key(task, index);
+	struct task **link = task_index_head(index, key);
+
+	while (*link != NULL) {
+		if (*link == task) {
+			*link = task->index_next[index];
+			break;
+		}
+		link = &(*link)->index_next[index];
+	}
+
+	task->index_next[index] = NULL;
+}
+
+static void task_index_add(struct task *task)
+{
+	int i;
+
+	for (i = 0; i < TASK_INDEX_COUNT; i++)
+		task_index_insert(task, i);
+}
+
+static void task_index_delete(struct task *task)
+{
+	int i;
+
+	for (i = 0; i < TASK_INDEX_COUNT; i++)
+		task_index_remove(task, i);
+}
+
 static void *task_append(struct task *new_task)
 {
 	void *lock_local = &task_lock;
@@ -48,10 +118,12 @@ static void *task_append(struct task *new_task)
 
 	task_write_next(new_task, task_head);
 
-	if (!kernel->rebooting)
+	if (!kernel->rebooting) {
 		task_tail = task_write_next(task_tail, new_task);
-	else
+		task_index_add(new_task);
+	} else {
 		r = NULL;
+	}
 
 	spin_leave(&lock_local);
 
@@ -102,6 +174,8 @@ static struct task *task_create_from_pool(void)
 		new_task->id_group = task_current()->id_group;
 		new_task->id_session = task_current()->id_session;
 		new_task->owner = task_current();
+
+		task_index_add(new_task);
 	}
 
 	spin_leave(&lock_local);
@@ -194,6 +268,15 @@ static int task_caretaker(void *arg)
 				continue;
 			}
 
+			/*
+			 * The task structure may still be on a run queue. The
+			 * scheduler will drop it when it is dequeued next time.
+			 */
+			if (cpu_read32((const uint32_t *)&t1->sched.queued)) {
+				spin_unlock(&t1->active);
+				continue;
+			}
+
 			t2 = task_read_next(t1);
 			error_assumption = 0;
 
@@ -230,6 +313,7 @@ static int task_caretaker(void *arg)
 			 * Remove the middle structure from the list.
 			 */
 			task_write_next(t0, t2);
+			task_index_delete(t1);
 
 			t1->sp = 0;
 			t1->cr3 = 0;
@@ -306,6 +390,12 @@ static int task_caretaker(void *arg)
 			}
 		}
 
+		/*
+		 * Fill the pool of zeroed pages when there is nothing
+		 * else to do (the priority of this task is low).
+		 */
+		mm_zero_pages();
+
 		task_sleep(1000);
 	}
 
@@ -379,6 +469,13 @@ int task_init(void)
 	if (current->id != 1 || current->id_owner != 0)
 		return DE_UNEXPECTED;
 
+	/*
+	 * The floating point state is saved only if the task has used
+	 * it after the previous task switch (fstate_loaded). The task-switched
+	 * bit is set and the state is restored when the next floating
+	 * point instruction raises the device-not-available exception.
+	 */
+	current->fstate_loaded = 1;
 	task_switch_asm(current, gdt_get_tss());
 	current->active = 1;
 
@@ -387,6 +484,7 @@ int task_init(void)
 
 	task_head = (task_tail = current);
 	task_struct_count = 1;
+	task_index_add(current);
 
 	ap_count = (uint32_t)kernel->smp_ap_count;
 	cpu_write32((uint32_t *)&task_ap_sync, 1);
@@ -422,6 +520,7 @@ int task_init_ap(void)
 	current->owner = task_head;
 	current->event.func = task_null_func;
 
+	current->fstate_loaded = 1;
 	task_switch_asm(current, gdt_get_tss());
 	current->active = 1;
 	current->detached = 1;
@@ -462,19 +561,17 @@ struct task *task_find(uint64_t id)
 		spin_lock(&task_lock);
 
 		/*
-		 * The circular linked list must be fully valid when the
-		 * task lock is acquired. No other code can modify task
-		 * structure identifications or the linked list.
+		 * The indexes are valid when the task lock is acquired.
 		 */
-		do {
+		t = *task_index_head(TASK_INDEX_ID, id);
+
+		while (t != NULL) {
 			if (t->id == id) {
 				r = t;
 				break;
 			}
-
-			t = task_read_next(t);
-
-		} while (t != task_head);
+			t = t->index_next[TASK_INDEX_ID];
+		}
 
 		spin_unlock(&task_lock);
 		task_switch_enable();
@@ -584,6 +681,10 @@ uint64_t task_create(int (*func)(void *), void *arg, int type)
 		new_task->uniproc = 1;
 
 	new_task->sched.priority = current->sched.priority;
+	new_task->sched.affinity = cpu_read64(&current->sched.affinity);
+	new_task->sched.policy = current->sched.policy;
+	new_task->sched.rt_priority = current->sched.rt_priority;
+	new_task->sched.cpu = -1;
 	new_task->sig.mask = current->sig.mask;
 
 	if (current->fd.state)
@@ -592,6 +693,8 @@ uint64_t task_create(int (*func)(void *), void *arg, int type)
 	task_create_asm(new_task, func, arg);
 	spin_unlock(&new_task->active);
 
+	kernel->scheduler.enqueue(new_task);
+
 	return id;
 }
 
@@ -648,6 +751,90 @@ void task_foreach(int (*func)(struct task *, void *), void *arg)
 	}
 }
 
+static void task_foreach_index(int index, uint64_t key,
+	int (*func)(struct task *, void *), void *arg)
+{
+	struct task *current = task_current();
+	struct task *t;
+	int r = 0;
+
+	if ((cpu_read_flags() & CPU_INTERRUPT_FLAG) == 0)
+		panic("Enumerating task structs while interrupts disabled.");
+
+	if (task_head == NULL)
+		return;
+
+	/*
+	 * Do not disable interrupts. Task switching must be
+	 * temporarily suspended.
+	 */
+	task_switch_disable();
+	spin_lock(&task_lock);
+
+	t = *task_index_head(index, key);
+
+	/*
+	 * The next pointer is read before calling the input function,
+	 * because it is allowed to change the group identifications
+	 * with the task_set_group function.
+	 */
+	while (t != NULL) {
+		struct task *next = t->index_next[index];
+
+		if (t != current && task_index_key(t, index) == key) {
+			if ((r = func(t, arg)) != 0)
+				break;
+		}
+
+		t = next;
+	}
+
+	/*
+	 * The current task structure is always the last one to be
+	 * processed by the input function, even if the key does not
+	 * match. This is compatible with the task_foreach function.
+	 */
+	if (r == 0)
+		func(current, arg);
+
+	spin_unlock(&task_lock);
+	task_switch_enable();
+}
+
+void task_foreach_id(uint64_t id,
+	int (*func)(struct task *, void *), void *arg)
+{
+	task_foreach_index(TASK_INDEX_ID, id, func, arg);
+}
+
+void task_foreach_group(uint64_t id_group,
+	int (*func)(struct task *, void *), void *arg)
+{
+	task_foreach_index(TASK_INDEX_GROUP, id_group, func, arg);
+}
+
+void task_foreach_session(uint64_t id_session,
+	int (*func)(struct task *, void *), void *arg)
+{
+	task_foreach_index(TASK_INDEX_SESSION, id_session, func, arg);
+}
+
+void task_set_group(struct task *task, uint64_t id_group, uint64_t id_session)
+{
+	/*
+	 * The task_lock must be held, i.e. this function is called
+	 * from the task_access or task_foreach input functions.
+	 */
+	task_index_remove(task, TASK_INDEX_GROUP);
+	task_index_remove(task, TASK_INDEX_SESSION);
+
+	task->id_group = id_group;
+	task->id_session = id_session;
+
+	task_index_insert(task, TASK_INDEX_GROUP);
+	task_index_insert(task, TASK_INDEX_SESSION);
+}
+
 void task_set_cmdline(struct task *task, void *line, const char *cline)
 {
 	void *lock_local = &task_lock;
@@ -724,6 +911,82 @@ void task_identify(uint64_t *id, uint64_t *id_owner,
 	spin_leave(&lock_local);
 }
 
+/*
+ * The processor time is measured with the time-stamp counter. The
+ * time is charged to the previous task when switching tasks, and the
+ * system call handler changes the user mode flag of the task.
+ */
+static uint64_t task_read_tsc(void)
+{
+	uint32_t tsc_a, tsc_d;
+
+	cpu_rdtsc(&tsc_a, &tsc_d);
+
+	return (((uint64_t)tsc_d << 16) << 16) | (uint64_t)tsc_a;
+}
+
+static void task_account(struct task *task, uint64_t tsc)
+{
+	uint64_t delta = 0;
+
+	if (task->cpu.tsc != 0 && task->cpu.tsc < tsc)
+		delta = tsc - task->cpu.tsc;
+
+	if (task->cpu.user_mode)
+		task->cpu.user += delta;
+	else
+		task->cpu.system += delta;
+
+	task->cpu.tsc = tsc;
+}
+
+static uint64_t task_tsc_to_ns(uint64_t tsc)
+{
+	uint64_t hz = kernel->delay_tsc_hz;
+
+	if (hz == 0)
+		return 0;
+
+	return (tsc / hz) * 1000000000 + ((tsc % hz) * 1000000000) / hz;
+}
+
+void task_account_mode(int user_mode)
+{
+	struct task *current;
+	int r = cpu_ints(0);
+
+	current = task_current();
+	task_account(current, task_read_tsc());
+	current->cpu.user_mode = user_mode;
+
+	cpu_ints(r);
+}
+
+void task_read_cpu_time(struct task *task, uint64_t *user_ns,
+	uint64_t *system_ns, uint64_t *child_ns)
+{
+	if (task == task_current()) {
+		int r = cpu_ints(0);
+
+		task_account(task, task_read_tsc());
+		cpu_ints(r);
+	}
+
+	if (user_ns)
+		*user_ns = task_tsc_to_ns(cpu_read64(&task->cpu.user));
+
+	if (system_ns)
+		*system_ns = task_tsc_to_ns(cpu_read64(&task->cpu.system));
+
+	if (child_ns) {
+		uint64_t child_user = cpu_read64(&task->cpu.child_user);
+		uint64_t child_system = cpu_read64(&task->cpu.child_system);
+
+		child_ns[0] = task_tsc_to_ns(child_user);
+		child_ns[1] = task_tsc_to_ns(child_system);
+	}
+}
+
 int task_check_event(struct task *task)
 {
 	struct task *current = task_current();
@@ -790,6 +1053,97 @@ void task_write_event(int (*func)(uint64_t *data), uint64_t d0, uint64_t d1)
 	cpu_ints(r);
 }
 
+static int task_block_func(uint64_t *data)
+{
+	const struct task *task = (const struct task *)((addr_t)data[1]);
+
+	if (cpu_read32(&task->sched.blocked) == task_block_none)
+		return 0;
+
+	return (data[0] > timer_read_ns());
+}
+
+static void task_block_timer(void *arg)
+{
+	task_wakeup((struct task *)arg);
+}
+
+void task_block_prepare(uint64_t deadline)
+{
+	struct task *current = task_current();
+	uint64_t d1 = (uint64_t)((addr_t)current);
+
+	/*
+	 * The blocked state must be set before the caller checks the
+	 * condition that it waits for. Otherwise, the wakeup could be
+	 * lost. The task is not on a run queue, and the deadline is
+	 * handled by the timer (see timer.c).
+	 */
+	cpu_write32(&current->sched.blocked, task_block_wakeup);
+
+	if (deadline == 0)
+		return;
+
+	if (!timer_arm(&current->timer, deadline, task_block_timer, current))
+		return;
+
+	/*
+	 * Poll the deadline if the timer could not be armed.
+	 */
+	cpu_write32(&current->sched.blocked, task_block_timeout);
+	task_write_event(task_block_func, deadline, d1);
+}
+
+int task_block(void)
+{
+	struct task *current = task_current();
+	int r;
+
+	if (cpu_read32(&current->sched.blocked) == task_block_timeout) {
+		do {
+			task_yield();
+		} while (task_read_event());
+	}
+
+	while (cpu_read32(&current->sched.blocked) == task_block_wakeup)
+		task_yield();
+
+	r = (cpu_read32(&current->sched.blocked) != task_block_none);
+	task_block_cancel();
+
+	return r;
+}
+
+void task_block_cancel(void)
+{
+	struct task *current = task_current();
+	int r;
+
+	timer_cancel(&current->timer);
+
+	r = cpu_ints(0);
+
+	current->event.func = task_null_func;
+	cpu_btr32(&current->event.state, 0);
+
+	current->event.data[0] = 0;
+	current->event.data[1] = 0;
+
+	cpu_write32(&current->sched.blocked, task_block_none);
+
+	cpu_ints(r);
+}
+
+void task_wakeup(struct task *task)
+{
+	if (cpu_read32(&task->sched.blocked) == task_block_none)
+		return;
+
+	cpu_write32(&task->sched.blocked, task_block_none);
+	cpu_add32(&task->cpu.wakeups, 1);
+	kernel->scheduler.enqueue(task);
+}
+
 void task_idle(void)
 {
 	if ((cpu_read_flags() & CPU_INTERRUPT_FLAG) != 0)
@@ -833,6 +1187,7 @@ void task_exit(int retval)
 		panic(unexpected);
 
 	cpu_add32(&current->owner->descendant.data[0], 1);
+	task_wakeup(current->owner);
 
 	while (current->stopped)
 		task_yield();
@@ -847,26 +1202,34 @@ void task_jump(addr_t user_ip, addr_t user_sp)
 	addr_t cs = gdt_user_code | 3;
 	addr_t ss = gdt_user_data | 3;
 
+	task_account_mode(1);
 	task_jump_asm(user_ip, cs, user_sp, ss);
 }
 
-static int task_sleep_func(uint64_t *data)
+void task_sleep(uint64_t milliseconds)
 {
-	return (data[0] > timer_read());
+	uint64_t nanoseconds = milliseconds * 1000000;
+
+	if (nanoseconds / 1000000 != milliseconds)
+		nanoseconds = (uint64_t)(ULLONG_MAX);
+
+	task_sleep_ns(nanoseconds);
 }
 
-void task_sleep(uint64_t milliseconds)
+void task_sleep_ns(uint64_t nanoseconds)
 {
-	uint64_t data = timer_read() + milliseconds;
-
-	if (data < milliseconds)
-		data = (uint64_t)(ULLONG_MAX);
+	uint64_t deadline = timer_read_ns() + nanoseconds;
 
-	task_write_event(task_sleep_func, data, 0);
+	if (deadline < nanoseconds)
+		deadline = (uint64_t)(ULLONG_MAX);
 
-	do {
-		task_yield();
-	} while (task_read_event());
+	/*
+	 * Nobody wakes up this task, so the wait ends at the deadline.
+	 */
+	while (deadline > timer_read_ns()) {
+		task_block_prepare(deadline);
+		task_block();
+	}
 }
 
 int task_switch(struct task *next)
@@ -941,9 +1304,25 @@ int task_switch(struct task *next)
 		next->event.data[1] = 0;
 	}
 
+	/*
+	 * Charge the processor time to the current task. The next task
+	 * starts its time slice from the same time-stamp.
+	 */
+	{
+		struct task *current = task_current();
+		uint64_t tsc = task_read_tsc();
+
+		task_account(current, tsc);
+		current->cpu.switches += 1;
+		next->cpu.tsc = tsc;
+
+		gdt_get_data()->switches += 1;
+	}
+
 	/*
 	 * Call the assembly function, which will take care of the rest.
 	 */
+	pg_switch_user(next);
 	task_switch_asm(next, tss);
 
 	/*
@@ -955,19 +1334,13 @@ int task_switch(struct task *next)
 	return 0;
 }
 
-static int task_wait_descendant_func(uint64_t *data)
+static void task_add_child_time(struct task *task, struct task *child)
 {
-	struct task *t = (struct task *)((addr_t)data[0]);
-	unsigned int ticks0 = (unsigned int)data[1];
-	unsigned int ticks1 = (unsigned int)timer_ticks;
+	uint64_t user = child->cpu.user + child->cpu.child_user;
+	uint64_t system = child->cpu.system + child->cpu.child_system;
 
-	if (t->descendant.data[0] != t->descendant.data[1])
-		return 0;
-
-	if ((ticks1 - ticks0) >= 2000)
-		return 0;
-
-	return 1;
+	task->cpu.child_user += user;
+	task->cpu.child_system += system;
 }
 
 static int task_wait_descendant_shared(uint64_t *id, uint64_t id_group,
@@ -1009,6 +1382,7 @@ static int task_wait_descendant_shared(uint64_t *id, uint64_t id_group,
 					if (spin_trylock(&t->detached)) {
 						out_id = t->id;
 						out_retval = t->retval;
+						task_add_child_time(current, t);
 					} else {
 						valid_candidate = 0;
 					}
@@ -1028,7 +1402,7 @@ static int task_wait_descendant_shared(uint64_t *id, uint64_t id_group,
 			break;
 
 		if (t != NULL) {
-			uint64_t d0, d1;
+			uint32_t *data = &current->descendant.data[0];
 
 			if (!descendant_state || mode_trywait)
 				break;
@@ -1038,13 +1412,17 @@ static int task_wait_descendant_shared(uint64_t *id, uint64_t id_group,
 				break;
 			}
 
-			d0 = (uint64_t)((addr_t)current);
-			d1 = (uint64_t)timer_ticks;
-			task_write_event(task_wait_descendant_func, d0, d1);
+			/*
+			 * The descendant tasks wake up this task when they
+			 * exit. The deadline makes sure that the list will
+			 * be checked again even if the owner was changed.
+			 */
+			task_block_prepare(timer_read_ns() + 2000000000);
 
-			do {
-				task_yield();
-			} while (task_read_event());
+			if (cpu_read32(&data[0]) == data[1])
+				task_block();
+			else
+				task_block_cancel();
 		}
 
 		descendant_state = 0;
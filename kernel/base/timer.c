@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * base/timer.c
+ *      One-shot timers
+ */
+
+#include <dancy.h>
+
+/*
+ * The armed timers are kept in a binary min-heap that is ordered by
+ * the deadlines. The local APIC timer of the bootstrap processor is
+ * programmed (one-shot mode) to fire when the first deadline expires.
+ */
+#define TIMER_VECTOR (0x5E)
+#define TIMER_INITIAL_SIZE (256)
+#define TIMER_MAX_DELTA (1000000000ull)
+
+static int timer_lock;
+static int timer_expire_lock;
+
+static struct timer **timer_heap;
+static int timer_heap_size;
+static int timer_heap_count;
+
+static volatile uint64_t timer_next = (uint64_t)(ULLONG_MAX);
+static struct timer * volatile timer_running;
+
+static uint64_t timer_tsc_base;
+static uint32_t timer_apic_rate;
+
+int timer_init(void)
+{
+	static int run_once;
+	uint32_t tsc_a, tsc_d, count;
+	size_t size = TIMER_INITIAL_SIZE * sizeof(*timer_heap);
+
+	if (!spin_trylock(&run_once))
+		return DE_UNEXPECTED;
+
+	cpu_rdtsc(&tsc_a, &tsc_d);
+	timer_tsc_base = (((uint64_t)tsc_d << 16) << 16) | (uint64_t)tsc_a;
+
+	if ((timer_heap = malloc(size)) == NULL)
+		return DE_MEMORY;
+
+	timer_heap_size = TIMER_INITIAL_SIZE;
+
+	/*
+	 * The periodic timers of the application processors are used
+	 * only if the I/O APIC is enabled. Otherwise, the timers are
+	 * expired when the scheduler is called.
+	 */
+	if (!kernel->io_apic_enabled)
+		return 0;
+
+	/*
+	 * Calibrate the local APIC timer (divide by 16).
+	 */
+	apic_write(0x320, 0x00010000 | TIMER_VECTOR);
+	apic_write(0x3E0, 0x00000003);
+	apic_write(0x380, 0xFFFFFFFF);
+
+	delay(10000000);
+
+	count = 0xFFFFFFFF - apic_read(0x390);
+	apic_write(0x380, 0);
+
+	if ((timer_apic_rate = count / 10) != 0)
+		apic_write(0x320, TIMER_VECTOR);
+
+	return 0;
+}
+
+uint64_t timer_read_ns(void)
+{
+	uint64_t hz = kernel->delay_tsc_hz;
+	uint32_t tsc_a, tsc_d;
+	uint64_t tsc;
+
+	if (hz == 0)
+		return timer_read() * 1000000;
+
+	cpu_rdtsc(&tsc_a, &tsc_d);
+	tsc = (((uint64_t)tsc_d << 16) << 16) | (uint64_t)tsc_a;
+	tsc -= timer_tsc_base;
+
+	return (tsc / hz) * 1000000000 + ((tsc % hz) * 1000000000) / hz;
+}
+
+static void timer_place(int i, struct timer *t)
+{
+	timer_heap[i] = t;
+	t->index = i + 1;
+}
+
+static void timer_sift_up(int i)
+{
+	struct timer *t = timer_heap[i];
+
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+
+		if (timer_heap[parent]->deadline <= t->deadline)
+			break;
+
+		timer_place(i, timer_heap[parent]);
+		i = parent;
+	}
+
+	timer_place(i, t);
+}
+
+static void timer_sift_down(int i)
+{
+	struct timer *t = timer_heap[i];
+
+	for (;;) {
+		int child = i * 2 + 1;
+
+		if (child >= timer_heap_count)
+			break;
+
+		if (child + 1 < timer_heap_count) {
+			uint64_t d0 = timer_heap[child]->deadline;
+			uint64_t d1 = timer_heap[child + 1]->deadline;
+
+			if (d1 < d0)
+				child += 1;
+		}
+
+		if (t->deadline <= timer_heap[child]->deadline)
+			break;
+
+		timer_place(i, timer_heap[child]);
+		i = child;
+	}
+
+	timer_place(i, t);
+}
+
+static void timer_remove(struct timer *t)
+{
+	int i = t->index - 1;
+	struct timer *last;
+
+	t->index = 0;
+
+	if (i != (timer_heap_count -= 1)) {
+		last = timer_heap[timer_heap_count];
+		timer_place(i, last);
+		timer_sift_down(i);
+		timer_sift_up(last->index - 1);
+	}
+
+	timer_heap[timer_heap_count] = NULL;
+}
+
+static void timer_update(void)
+{
+	uint64_t next = (uint64_t)(ULLONG_MAX);
+
+	if (timer_heap_count > 0)
+		next = timer_heap[0]->deadline;
+
+	timer_next = next;
+}
+
+static void timer_program(void)
+{
+	uint64_t delta = 0, count;
+	uint64_t now = timer_read_ns();
+
+	/*
+	 * Only the bootstrap processor uses its local APIC timer. The
+	 * timer_lock must be held, so the interrupts are disabled.
+	 */
+	if (timer_heap_count == 0) {
+		apic_write(0x380, 0);
+		return;
+	}
+
+	if (timer_heap[0]->deadline > now)
+		delta = timer_heap[0]->deadline - now;
+
+	if (delta > TIMER_MAX_DELTA)
+		delta = TIMER_MAX_DELTA;
+
+	count = ((delta * timer_apic_rate) / 1000000) + 1;
+
+	if (count > 0xFFFFFFFF)
+		count = 0xFFFFFFFF;
+
+	apic_write(0x380, (uint32_t)count);
+}
+
+static int timer_grow(void)
+{
+	void *lock_local = &timer_lock;
+	struct timer **new_heap, **old_heap;
+	int new_size = (int)cpu_read32(&timer_heap_size) * 2;
+
+	if ((cpu_read_flags() & CPU_INTERRUPT_FLAG) == 0)
+		return DE_MEMORY;
+
+	if (new_size < TIMER_INITIAL_SIZE)
+		new_size = TIMER_INITIAL_SIZE;
+
+	new_heap = malloc((size_t)new_size * sizeof(*new_heap));
+
+	if (new_heap == NULL)
+		return DE_MEMORY;
+
+	spin_enter(&lock_local);
+
+	if (timer_heap_size < new_size) {
+		size_t size = (size_t)timer_heap_count * sizeof(*new_heap);
+
+		if (size)
+			memcpy(new_heap, timer_heap, size);
+
+		old_heap = timer_heap;
+		timer_heap = new_heap;
+		timer_heap_size = new_size;
+	} else {
+		old_heap = new_heap;
+	}
+
+	spin_leave(&lock_local);
+	free(old_heap);
+
+	return 0;
+}
+
+int timer_arm(struct timer *t, uint64_t deadline,
+	void (*func)(void *arg), void *arg)
+{
+	void *lock_local = &timer_lock;
+	int cpu, first, r;
+
+	for (;;) {
+		spin_enter(&lock_local);
+
+		if (t->index != 0)
+			timer_remove(t);
+
+		if (timer_heap_count < timer_heap_size)
+			break;
+
+		spin_leave(&lock_local);
+
+		if ((r = timer_grow()) != 0)
+			return r;
+	}
+
+	t->deadline = deadline;
+	t->func = func;
+	t->arg = arg;
+
+	timer_place(timer_heap_count, t);
+	timer_heap_count += 1;
+	timer_sift_up(timer_heap_count - 1);
+
+	timer_update();
+
+	cpu = gdt_get_cpu();
+	first = (t->index == 1 && timer_apic_rate != 0);
+
+	if (first && cpu == 0)
+		timer_program();
+
+	spin_leave(&lock_local);
+
+	/*
+	 * Interrupt the bootstrap processor if the first deadline was
+	 * changed by another processor.
+	 */
+	if (first && cpu != 0)
+		apic_send_ipi(kernel->apic_bsp_id, TIMER_VECTOR);
+
+	return 0;
+}
+
+int timer_cancel(struct timer *t)
+{
+	void *lock_local = &timer_lock;
+	int r;
+
+	spin_enter(&lock_local);
+
+	if ((r = (t->index != 0)) != 0) {
+		timer_remove(t);
+		timer_update();
+	}
+
+	spin_leave(&lock_local);
+
+	/*
+	 * Wait for the callback function if it is being called.
+	 */
+	while (timer_running == t)
+		delay(1000);
+
+	return r;
+}
+
+void timer_expire(void)
+{
+	void *lock_local = &timer_lock;
+	uint64_t now = timer_read_ns();
+	int expired = 0;
+
+	if (now >= timer_next && spin_trylock(&timer_expire_lock)) {
+		for (;;) {
+			void (*func)(void *arg);
+			struct timer *t;
+			void *arg;
+
+			spin_enter(&lock_local);
+
+			t = (timer_heap_count > 0) ? timer_heap[0] : NULL;
+
+			if (t == NULL || t->deadline > now) {
+				spin_leave(&lock_local);
+				break;
+			}
+
+			timer_remove(t);
+			timer_update();
+
+			func = t->func, arg = t->arg;
+			timer_running = t;
+
+			spin_leave(&lock_local);
+
+			func(arg), expired = 1;
+			timer_running = NULL;
+		}
+
+		spin_unlock(&timer_expire_lock);
+	}
+
+	/*
+	 * Program the next deadline if the one-shot timer of the bootstrap
+	 * processor is not running anymore.
+	 */
+	if (timer_apic_rate != 0 && gdt_get_cpu() == 0) {
+		if (!expired && !cpu_read32(&timer_heap_count))
+			return;
+
+		if (!expired && apic_read(0x390) != 0)
+			return;
+
+		spin_enter(&lock_local);
+		timer_program();
+		spin_leave(&lock_local);
+	}
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * base/waitq.c
+ *      Wait queues
+ */
+
+#include <dancy.h>
+
+void waitq_init(struct waitq *wq)
+{
+	memset(wq, 0, sizeof(*wq));
+}
+
+void waitq_add(struct waitq *wq, struct waitq_entry *entry)
+{
+	void *lock_local = &wq->lock;
+
+	entry->task = task_current();
+
+	spin_enter(&lock_local);
+
+	entry->next = NULL;
+	entry->prev = wq->tail;
+
+	if (wq->tail != NULL)
+		wq->tail->next = entry;
+	else
+		wq->head = entry;
+
+	wq->tail = entry;
+	entry->linked = 1;
+
+	spin_leave(&lock_local);
+}
+
+static void waitq_unlink(struct waitq *wq, struct waitq_entry *entry)
+{
+	if (entry->prev != NULL)
+		entry->prev->next = entry->next;
+	else
+		wq->head = entry->next;
+
+	if (entry->next != NULL)
+		entry->next->prev = entry->prev;
+	else
+		wq->tail = entry->prev;
+
+	entry->next = NULL;
+	entry->prev = NULL;
+	entry->linked = 0;
+}
+
+void waitq_remove(struct waitq *wq, struct waitq_entry *entry)
+{
+	void *lock_local = &wq->lock;
+
+	spin_enter(&lock_local);
+
+	if (entry->linked)
+		waitq_unlink(wq, entry);
+
+	spin_leave(&lock_local);
+}
+
+static struct task *waitq_wake(struct waitq *wq, int count)
+{
+	struct task *first = NULL;
+	void *lock_local = &wq->lock;
+
+	/*
+	 * Do a quick test without locking the structure.
+	 */
+	if (wq->head == NULL)
+		return first;
+
+	spin_enter(&lock_local);
+
+	while (wq->head != NULL && count != 0) {
+		struct waitq_entry *entry = wq->head;
+		struct task *task = entry->task;
+
+		waitq_unlink(wq, entry);
+		task_wakeup(task);
+
+		if (first == NULL)
+			first = task;
+
+		count -= 1;
+	}
+
+	spin_leave(&lock_local);
+
+	return first;
+}
+
+struct task *waitq_wake_one(struct waitq *wq)
+{
+	return waitq_wake(wq, 1);
+}
+
+struct task *waitq_wake_all(struct waitq *wq)
+{
+	return waitq_wake(wq, -1);
+}
@@ -23,8 +23,11 @@ section .text
 
         global _cpu_id
         global _cpu_halt
+        global _cpu_idle
+        global _cpu_idle_monitor
         global _cpu_ints
         global _cpu_invlpg
+        global _cpu_invpcid
         global _cpu_wbinvd
         global _cpu_rdtsc
         global _cpu_rdtsc_delay
@@ -59,6 +62,7 @@ section .text
         global _cpu_write_cr3
         global _cpu_write_cr4
         global _cpu_xchg
+        global _cpu_zero_page
 
 align 16
         ; void cpu_id(uint32_t *a, uint32_t *c, uint32_t *d, uint32_t *b)
@@ -104,6 +108,30 @@ _cpu_halt:
         jnz short .spin2
         ret
 
+align 16
+        ; void cpu_idle(void)
+_cpu_idle:
+        call __serialize_execution      ; (registers preserved)
+        sti                             ; enable interrupts
+        hlt                             ; halt instruction
+        ret
+
+align 16
+        ; void cpu_idle_monitor(const void *address, uint32_t value)
+_cpu_idle_monitor:
+        call __serialize_execution      ; (registers preserved)
+        mov eax, [esp+4]                ; eax = address
+        xor ecx, ecx                    ; ecx = extensions
+        xor edx, edx                    ; edx = hints
+        monitor                         ; set up the address range
+        mov edx, [esp+8]                ; edx = value
+        cmp [eax], edx                  ; compare the monitored value
+        jne short .end
+        xor eax, eax                    ; eax = hints
+        sti                             ; enable interrupts
+        mwait                           ; wait for a write or interrupt
+.end:   ret
+
 align 16
         ; int cpu_ints(int enable)
 _cpu_ints:
@@ -125,6 +153,14 @@ _cpu_invlpg:
         invlpg [ecx]                    ; invalidate tlb entry
         ret
 
+align 16
+        ; void cpu_invpcid(cpu_native_t type, const void *descriptor)
+_cpu_invpcid:
+        mov ecx, [esp+4]                ; ecx = type
+        mov edx, [esp+8]                ; edx = descriptor
+        invpcid ecx, [edx]              ; invalidate tlb entries (pcid)
+        ret
+
 align 16
         ; void cpu_wbinvd(void)
 _cpu_wbinvd:
@@ -436,6 +472,20 @@ _cpu_xchg:
         xchg [ecx], eax                 ; exchange memory with register
         ret
 
+align 16
+        ; void cpu_zero_page(void *address)
+        ;
+        ; The SSE2 instructions (movnti) are not required on 32-bit.
+_cpu_zero_page:
+        push edi                        ; save register edi
+        mov edi, [esp+8]                ; edi = address
+        xor eax, eax                    ; eax = 0
+        mov ecx, 1024                   ; ecx = 4096 / 4
+        cld                             ; clear direction flag
+        rep stosd                       ; fill the page
+        pop edi                         ; restore register edi
+        ret
+
 align 16
         ; Internal procedure for serializing instruction execution
         ;
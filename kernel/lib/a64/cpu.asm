@@ -23,8 +23,11 @@ section .text
 
         global cpu_id
         global cpu_halt
+        global cpu_idle
+        global cpu_idle_monitor
         global cpu_ints
         global cpu_invlpg
+        global cpu_invpcid
         global cpu_wbinvd
         global cpu_rdtsc
         global cpu_rdtsc_delay
@@ -59,6 +62,7 @@ section .text
         global cpu_write_cr3
         global cpu_write_cr4
         global cpu_xchg
+        global cpu_zero_page
 
 align 16
         ; void cpu_id(uint32_t *a, uint32_t *c, uint32_t *d, uint32_t *b)
@@ -97,6 +101,30 @@ cpu_halt:
         jnz short .spin2
         ret
 
+align 16
+        ; void cpu_idle(void)
+cpu_idle:
+        call __serialize_execution      ; (registers preserved)
+        sti                             ; enable interrupts
+        hlt                             ; halt instruction
+        ret
+
+align 16
+        ; void cpu_idle_monitor(const void *address, uint32_t value)
+cpu_idle_monitor:
+        call __serialize_execution      ; (registers preserved)
+        mov rax, rcx                    ; rax = address
+        mov r8d, edx                    ; r8d = value
+        xor ecx, ecx                    ; ecx = extensions
+        xor edx, edx                    ; edx = hints
+        monitor                         ; set up the address range
+        cmp [rax], r8d                  ; compare the monitored value
+        jne short .end
+        xor eax, eax                    ; eax = hints
+        sti                             ; enable interrupts
+        mwait                           ; wait for a write or interrupt
+.end:   ret
+
 align 16
         ; int cpu_ints(int enable)
 cpu_ints:
@@ -117,6 +145,12 @@ cpu_invlpg:
         invlpg [rcx]                    ; invalidate tlb entry
         ret
 
+align 16
+        ; void cpu_invpcid(cpu_native_t type, const void *descriptor)
+cpu_invpcid:
+        invpcid rcx, [rdx]              ; invalidate tlb entries (pcid)
+        ret
+
 align 16
         ; void cpu_wbinvd(void)
 cpu_wbinvd:
@@ -401,6 +435,25 @@ cpu_xchg:
         xchg [rcx], rax                 ; exchange memory with register
         ret
 
+align 16
+        ; void cpu_zero_page(void *address)
+cpu_zero_page:
+        xor eax, eax                    ; rax = 0
+        mov edx, 64                     ; rdx = 4096 / 64
+.loop:  movnti [rcx+0], rax             ; non-temporal stores
+        movnti [rcx+8], rax
+        movnti [rcx+16], rax
+        movnti [rcx+24], rax
+        movnti [rcx+32], rax
+        movnti [rcx+40], rax
+        movnti [rcx+48], rax
+        movnti [rcx+56], rax
+        add rcx, 64                     ; rcx = next cache line
+        dec edx                         ; decrement counter
+        jnz short .loop
+        sfence                          ; order the stores
+        ret
+
 align 16
         ; Internal procedure for serializing instruction execution
         ;
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022 Antti Tiihala
+ * Copyright (c) 2022, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -71,6 +71,184 @@ struct coff {
 	size_t data_rel_size;
 };
 
+/*
+ * The relocated .text and .rdata sections are identical for all the
+ * processes that run the same executable, because the sections are
+ * always loaded to the same virtual addresses. The read-only pages
+ * are cached and shared by the address spaces.
+ */
+#define COFF_IMAGE_COUNT (16)
+#define COFF_IMAGE_MAX_PAGES (1024)
+
+struct coff_image {
+	int count;
+	int page_count;
+
+	struct vfs_stat stat;
+	size_t text_size;
+	size_t rdata_size;
+	size_t text_aligned_size;
+	size_t rdata_aligned_size;
+
+	char path[256];
+	phys_addr_t pages[1];
+};
+
+static int coff_image_lock;
+static struct coff_image *coff_images[COFF_IMAGE_COUNT];
+static unsigned int coff_image_next;
+
+static int coff_image_match(const struct coff_image *a,
+	const struct coff_image *b)
+{
+	if (a->stat.size != b->stat.size)
+		return 0;
+	if (a->stat.write_time.tv_sec != b->stat.write_time.tv_sec)
+		return 0;
+	if (a->stat.write_time.tv_nsec != b->stat.write_time.tv_nsec)
+		return 0;
+
+	if (a->text_size != b->text_size)
+		return 0;
+	if (a->rdata_size != b->rdata_size)
+		return 0;
+	if (a->text_aligned_size != b->text_aligned_size)
+		return 0;
+	if (a->rdata_aligned_size != b->rdata_aligned_size)
+		return 0;
+
+	return 1;
+}
+
+static struct coff_image *coff_image_create(struct vfs_node *node,
+	const struct coff *coff)
+{
+	size_t text_size = coff->text_aligned_size;
+	size_t rdata_size = coff->rdata_aligned_size;
+	struct coff_image *image;
+	size_t size;
+	int page_count;
+
+	if (task_current()->pg_image != NULL || text_size == 0)
+		return NULL;
+
+	if ((text_size + rdata_size) / 0x1000 > COFF_IMAGE_MAX_PAGES)
+		return NULL;
+
+	page_count = (int)((text_size + rdata_size) / 0x1000);
+
+	size = sizeof(*image);
+	size += (size_t)page_count * sizeof(image->pages[0]);
+
+	if ((image = malloc(size)) == NULL)
+		return NULL;
+
+	memset(image, 0, sizeof(*image));
+	image->page_count = page_count;
+
+	image->text_size = coff->text_size;
+	image->rdata_size = coff->rdata_size;
+	image->text_aligned_size = coff->text_aligned_size;
+	image->rdata_aligned_size = coff->rdata_aligned_size;
+
+	if (node->n_stat(node, &image->stat) != 0) {
+		free(image);
+		return NULL;
+	}
+
+	if (vfs_realpath(node, &image->path[0], sizeof(image->path)) != 0) {
+		free(image);
+		return NULL;
+	}
+
+	return image;
+}
+
+static struct coff_image *coff_image_find(const struct coff_image *key)
+{
+	void *lock_local = &coff_image_lock;
+	struct coff_image *image = NULL, *stale = NULL;
+	int i;
+
+	spin_enter(&lock_local);
+
+	for (i = 0; i < COFF_IMAGE_COUNT; i++) {
+		struct coff_image *p = coff_images[i];
+
+		if (p == NULL || strcmp(&p->path[0], &key->path[0]))
+			continue;
+
+		if (coff_image_match(p, key)) {
+			cpu_add32(&p->count, 1);
+			image = p;
+		} else {
+			coff_images[i] = NULL;
+			stale = p;
+		}
+		break;
+	}
+
+	spin_leave(&lock_local);
+
+	if (stale != NULL)
+		coff_release_image(stale);
+
+	return image;
+}
+
+static void coff_image_insert(struct coff_image *image)
+{
+	void *lock_local = &coff_image_lock;
+	struct coff_image *old_image = NULL;
+	addr_t vaddr = 0x10000000;
+	size_t size = (size_t)image->page_count * 0x1000;
+	int i;
+
+	if (pg_share_user(vaddr, size, &image->pages[0]) != 0) {
+		free(image);
+		return;
+	}
+
+	/*
+	 * One reference for the cache and one for the address space.
+	 */
+	image->count = 2;
+	task_current()->pg_image = image;
+
+	spin_enter(&lock_local);
+
+	for (i = 0; i < COFF_IMAGE_COUNT; i++) {
+		struct coff_image *p = coff_images[i];
+
+		if (p == NULL || !strcmp(&p->path[0], &image->path[0]))
+			break;
+	}
+
+	if (i == COFF_IMAGE_COUNT)
+		i = (int)(coff_image_next++ % COFF_IMAGE_COUNT);
+
+	old_image = coff_images[i];
+	coff_images[i] = image;
+
+	spin_leave(&lock_local);
+
+	if (old_image != NULL)
+		coff_release_image(old_image);
+}
+
+void coff_release_image(struct coff_image *image)
+{
+	int i;
+
+	if (cpu_sub32(&image->count, 1) != 0)
+		return;
+
+	for (i = 0; i < image->page_count; i++)
+		mm_free_page(image->pages[i]);
+
+	free(image);
+}
+
 static int coff_validate(const unsigned char *obj)
 {
 	if (LE16(&obj[0]) != coff_native_signature)
@@ -101,7 +279,7 @@ static int coff_validate(const unsigned char *obj)
 	return 0;
 }
 
-static int coff_allocate(struct coff *coff)
+static int coff_allocate(struct coff *coff, struct coff_image *image)
 {
 	addr_t vaddr = 0x80000000;
 	size_t size;
@@ -135,8 +313,15 @@ static int coff_allocate(struct coff *coff)
 	coff->text_vaddr = size ? vaddr : (addr_t)0;
 	type = pg_readonly;
 
-	if (size && (addr_t)pg_map_user(vaddr, size, type) != vaddr)
+	if (size && image != NULL) {
+		const phys_addr_t *pages = &image->pages[0];
+
+		if ((addr_t)pg_map_shared(vaddr, size, pages, type) != vaddr)
+			return DE_MEMORY;
+
+	} else if (size && (addr_t)pg_map_user(vaddr, size, type) != vaddr) {
 		return DE_MEMORY;
+	}
 
 	vaddr += (addr_t)size;
 
@@ -147,8 +332,17 @@ static int coff_allocate(struct coff *coff)
 	coff->rdata_vaddr = size ? vaddr : (addr_t)0;
 	type = pg_readonly | pg_noexec;
 
-	if (size && (addr_t)pg_map_user(vaddr, size, type) != vaddr)
+	if (size && image != NULL) {
+		const phys_addr_t *pages = &image->pages[0];
+
+		pages += coff->text_aligned_size / 0x1000;
+
+		if ((addr_t)pg_map_shared(vaddr, size, pages, type) != vaddr)
+			return DE_MEMORY;
+
+	} else if (size && (addr_t)pg_map_user(vaddr, size, type) != vaddr) {
 		return DE_MEMORY;
+	}
 
 	vaddr += (addr_t)size;
 
@@ -169,7 +363,7 @@ static int coff_allocate(struct coff *coff)
 	 */
 	size = coff->bss_aligned_size;
 	coff->bss_vaddr = size ? vaddr : (addr_t)0;
-	type = pg_noexec;
+	type = pg_noexec | pg_lazy;
 
 	if (size && (addr_t)pg_map_user(vaddr, size, type) != vaddr)
 		return DE_MEMORY;
@@ -198,8 +392,10 @@ static int coff_copy(struct vfs_node *node,
 	return 0;
 }
 
-int coff_load_executable(struct vfs_node *node, addr_t *start_addr)
+static int coff_load(struct vfs_node *node,
+	addr_t *start_addr, struct coff_image **image)
 {
+	struct coff_image *cached = NULL;
 	unsigned char *obj;
 	struct coff *coff;
 	size_t size;
@@ -306,13 +502,23 @@ int coff_load_executable(struct vfs_node *node, addr_t *start_addr)
 		coff->data_rel_size  = coff->data_nrel  * 10;
 	}
 
-	if ((r = coff_allocate(coff)) != 0)
+	/*
+	 * Use the cached .text and .rdata sections if available.
+	 */
+	if ((*image = coff_image_create(node, coff)) != NULL) {
+		if ((cached = coff_image_find(*image)) != NULL) {
+			free(*image), *image = NULL;
+			task_current()->pg_image = cached;
+		}
+	}
+
+	if ((r = coff_allocate(coff, cached)) != 0)
 		return r;
 
 	/*
 	 * Copy all the sections.
 	 */
-	if (coff->text_size) {
+	if (coff->text_size && !cached) {
 		uint32_t o = coff->text_sec;
 		size_t s = coff->text_size;
 		addr_t v = coff->text_vaddr;
@@ -321,7 +527,7 @@ int coff_load_executable(struct vfs_node *node, addr_t *start_addr)
 			return r;
 	}
 
-	if (coff->rdata_size) {
+	if (coff->rdata_size && !cached) {
 		uint32_t o = coff->rdata_sec;
 		size_t s = coff->rdata_size;
 		addr_t v = coff->rdata_vaddr;
@@ -342,7 +548,7 @@ int coff_load_executable(struct vfs_node *node, addr_t *start_addr)
 	/*
 	 * Copy all the relocations.
 	 */
-	if (coff->text_rel_size) {
+	if (coff->text_rel_size && !cached) {
 		uint32_t o = coff->text_rel;
 		size_t s = coff->text_rel_size;
 		addr_t v = coff->stack_vaddr[0];
@@ -351,7 +557,7 @@ int coff_load_executable(struct vfs_node *node, addr_t *start_addr)
 			return r;
 	}
 
-	if (coff->rdata_rel_size) {
+	if (coff->rdata_rel_size && !cached) {
 		uint32_t o = coff->rdata_rel;
 		size_t s = coff->rdata_rel_size;
 		addr_t v = coff->stack_vaddr[1];
@@ -428,7 +634,7 @@ int coff_load_executable(struct vfs_node *node, addr_t *start_addr)
 	/*
 	 * Relocate .text section.
 	 */
-	if (coff->text_nrel) {
+	if (coff->text_nrel && !cached) {
 		void *base = (void *)coff->text_vaddr;
 		unsigned char *reloc = (void *)coff->stack_vaddr[0];
 		unsigned char *st = (void *)coff->stack_vaddr[3];
@@ -454,7 +660,7 @@ int coff_load_executable(struct vfs_node *node, addr_t *start_addr)
 	/*
 	 * Relocate .rdata section.
 	 */
-	if (coff->rdata_nrel) {
+	if (coff->rdata_nrel && !cached) {
 		void *base = (void *)coff->rdata_vaddr;
 		unsigned char *reloc = (void *)coff->stack_vaddr[1];
 		unsigned char *st = (void *)coff->stack_vaddr[3];
@@ -518,3 +724,18 @@ int coff_load_executable(struct vfs_node *node, addr_t *start_addr)
 
 	return 0;
 }
+
+int coff_load_executable(struct vfs_node *node, addr_t *start_addr)
+{
+	struct coff_image *image = NULL;
+	int r = coff_load(node, start_addr, &image);
+
+	if (image != NULL) {
+		if (r == 0)
+			coff_image_insert(image);
+		else
+			free(image);
+	}
+
+	return r;
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021, 2024 Antti Tiihala
+ * Copyright (c) 2021, 2024, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -21,223 +21,617 @@
 
 static int sched_lock = 1;
 
+/*
+ * The run queue levels. The uniproc tasks are on their own level, and
+ * only the bootstrap processor (CPU 0) dequeues tasks from that level.
+ * The real-time level is ordered by the task priorities.
+ */
+enum sched_level {
+	sched_level_uniproc = 0,
+	sched_level_kernel,
+	sched_level_realtime,
+	sched_level_high,
+	sched_level_normal,
+	sched_level_low,
+	sched_level_count
+};
+
+struct sched_queue {
+	int lock;
+	int count;
+	int idle;
+	uint32_t apic_id;
+	uint32_t yield_count;
+	int starved_level;
+	int running_rank;
+	int apic_ready;
+	struct task *head[sched_level_count];
+	struct task *tail[sched_level_count];
+};
+
+#define SCHED_ATTEMPTS (8)
+#define SCHED_RESCHEDULE_VECTOR (0x5D)
+#define SCHED_WAKE_UP_VECTOR (0x5F)
+
+static int sched_queue_count;
+static struct sched_queue *sched_queue_array;
+
+static void enqueue(struct task *task);
 static void yield(void);
+static void preempt(void);
+
+static int enqueue_existing(struct task *task, void *arg)
+{
+	if (task != task_current())
+		enqueue(task);
+
+	return (void)arg, 0;
+}
 
 int sched_init(void)
 {
 	static int run_once;
 	void (**yield_pointer)(void);
+	void (**enqueue_pointer)(struct task *task);
+	void (**preempt_pointer)(void);
+	size_t size;
+	int i;
 
 	if (!spin_trylock(&run_once))
 		return DE_UNEXPECTED;
 
+	sched_queue_count = kernel->smp_ap_count + 1;
+
+	size = (size_t)sched_queue_count * sizeof(struct sched_queue);
+	sched_queue_array = malloc(size);
+
+	if (!sched_queue_array)
+		return DE_MEMORY;
+
+	memset(sched_queue_array, 0, size);
+
+	for (i = 0; i < sched_queue_count; i++)
+		sched_queue_array[i].starved_level = sched_level_high;
+
 	yield_pointer = &kernel->scheduler.yield;
+	enqueue_pointer = &kernel->scheduler.enqueue;
+	preempt_pointer = &kernel->scheduler.preempt;
 
 	spin_unlock(&sched_lock);
+	*enqueue_pointer = enqueue;
+
+	/*
+	 * The tasks that were created before the scheduler was ready.
+	 */
+	task_foreach(enqueue_existing, NULL);
+
 	*yield_pointer = yield;
+	*preempt_pointer = preempt;
 
 	return 0;
 }
 
-static void yield(void)
+static int task_level(const struct task *task)
 {
-	static uint32_t count;
+	int priority = task->sched.priority;
 
-	struct task *current = task_current(), *next, *start;
-	int current_priority = current->sched.priority;
-	int current_runnable = !task_check_event(NULL);
-	int search_task = 1;
+	if (task->uniproc)
+		return sched_level_uniproc;
 
-	if (!spin_trylock(&current->sched.lock))
+	if (task->sched.policy != sched_policy_other)
+		return sched_level_realtime;
+
+	if (priority == sched_priority_kernel)
+		return sched_level_kernel;
+
+	if (priority < sched_priority_high || priority > sched_priority_low)
+		priority = sched_priority_low;
+
+	return priority - sched_priority_high + sched_level_high;
+}
+
+static int task_rank(const struct task *task)
+{
+	int level = task_level(task);
+
+	/*
+	 * The rank is used for comparing the running task and the real-time
+	 * tasks. The kernel tasks have the highest rank.
+	 */
+	if (level < sched_level_realtime)
+		return SCHED_RT_PRIORITY_MAX + 1;
+
+	if (level == sched_level_realtime)
+		return task->sched.rt_priority;
+
+	return 0;
+}
+
+static int allowed(const struct task *task, int cpu)
+{
+	uint64_t affinity = cpu_read64(&task->sched.affinity);
+
+	/*
+	 * The affinity mask covers the first 64 processors, and all
+	 * processors are allowed if the mask is zero.
+	 */
+	if (affinity == 0)
+		return 1;
+
+	if (cpu >= 64)
+		return 0;
+
+	return (int)((affinity >> cpu) & 1);
+}
+
+static int top_level(const struct sched_queue *q, int first)
+{
+	int i;
+
+	/*
+	 * This is only a hint, and the queue is not locked.
+	 */
+	for (i = first; i < sched_level_count; i++) {
+		if (q->head[i] != NULL)
+			return i;
+	}
+
+	return sched_level_count;
+}
+
+static void wake_up(struct sched_queue *q)
+{
+	if (!cpu_read32(&q->idle))
 		return;
 
 	/*
-	 * Make sure that all tasks will get a chance to run.
+	 * The processor that is waiting on the monitored idle flag is
+	 * woken up by writing the flag. Otherwise, it is halted and the
+	 * event interrupt is needed.
 	 */
-	if ((cpu_add32(&count, 1) & 0x1F) == 0) {
-		struct task *next_starved = NULL;
+	if (kernel->cpu_feature.monitor) {
+		cpu_write32(&q->idle, 0);
+		return;
+	}
 
-		next = start = current;
+	apic_send_ipi(q->apic_id, SCHED_WAKE_UP_VECTOR);
+}
 
-		while ((next = task_read_next(next)) && next != start) {
-			uint32_t state = next->sched.state;
+static void insert_realtime(struct sched_queue *q, struct task *task)
+{
+	const int level = sched_level_realtime;
+	int priority = task->sched.rt_priority;
+	struct task *prev = NULL, *t = q->head[level];
 
-			if (!task_check_event(next)) {
-				if (!next_starved)
-					next_starved = next;
-				if (next_starved->sched.state < state)
-					next_starved = next;
-			}
+	/*
+	 * The tasks that have the same priority are in FIFO order. The
+	 * queue must be locked.
+	 */
+	while (t != NULL && t->sched.rt_priority >= priority) {
+		prev = t;
+		t = t->sched.next;
+	}
+
+	task->sched.next = t;
+
+	if (prev != NULL)
+		prev->sched.next = task;
+	else
+		q->head[level] = task;
+
+	if (t == NULL)
+		q->tail[level] = task;
+}
+
+static void reschedule(struct sched_queue *q, int cpu)
+{
+	if (!cpu_read32(&q->apic_ready) || cpu == gdt_get_cpu())
+		return;
+
+	apic_send_ipi(q->apic_id, SCHED_RESCHEDULE_VECTOR);
+}
+
+static void enqueue(struct task *task)
+{
+	struct sched_queue *q;
+	void *lock_local;
+	int cpu, level;
+
+	/*
+	 * The blocked tasks are enqueued again by task_wakeup. Test the
+	 * state after setting the flag, and test it again after clearing
+	 * the flag, because a concurrent task_wakeup may have seen the
+	 * flag set (see also the dequeue function).
+	 */
+	for (;;) {
+		if (task->stopped || !spin_trylock(&task->sched.queued))
+			return;
+
+		if (cpu_read32(&task->sched.blocked) != task_block_wakeup)
+			break;
+
+		spin_unlock(&task->sched.queued);
+
+		if (cpu_read32(&task->sched.blocked) == task_block_wakeup)
+			return;
+	}
+
+	level = task_level(task);
+	cpu = task->sched.cpu;
+
+	/*
+	 * New tasks are given to the processor that has the shortest
+	 * run queue. Other tasks stay on the processor they ran last
+	 * if the affinity mask allows it.
+	 */
+	if (cpu < 0 || cpu >= sched_queue_count || !allowed(task, cpu)) {
+		int i, count = INT_MAX;
+
+		for (cpu = 0, i = 0; i < sched_queue_count; i++) {
+			int c = (int)cpu_read32(&sched_queue_array[i].count);
+
+			if (!allowed(task, i))
+				continue;
+
+			if (count > c)
+				count = c, cpu = i;
 		}
 
-		if (next_starved) {
-			next_starved->sched.state = 0;
+		task->sched.cpu = cpu;
+	}
+
+	if (level == sched_level_uniproc)
+		cpu = 0;
+
+	q = &sched_queue_array[cpu];
+	lock_local = &q->lock;
+
+	spin_enter(&lock_local);
+
+	task->sched.next = NULL;
+
+	if (level == sched_level_realtime) {
+		insert_realtime(q, task);
 
-			if (!task_switch(next_starved)) {
-				spin_unlock(&current->sched.lock);
-				return;
+	} else {
+		if (q->tail[level] != NULL)
+			q->tail[level]->sched.next = task;
+		else
+			q->head[level] = task;
+
+		q->tail[level] = task;
+	}
+
+	q->count += 1;
+
+	spin_leave(&lock_local);
+
+	/*
+	 * Wake up the processor if it is idle. Otherwise, if there is
+	 * more work than one task, an idle processor may steal it. The
+	 * real-time tasks preempt the lower ranked running tasks.
+	 */
+	if (cpu_read32(&q->idle)) {
+		wake_up(q);
+
+	} else if (level == sched_level_realtime) {
+		if (task_rank(task) > (int)cpu_read32(&q->running_rank))
+			reschedule(q, cpu);
+
+	} else if (cpu > 0 && cpu_read32(&q->count) > 1) {
+		int i;
+
+		for (i = 1; i < sched_queue_count; i++) {
+			if (cpu_read32(&sched_queue_array[i].idle)) {
+				wake_up(&sched_queue_array[i]);
+				break;
 			}
 		}
 	}
+}
+
+static struct task *dequeue(struct sched_queue *q, int level)
+{
+	struct task *task;
+	void *lock_local = &q->lock;
+
+	spin_enter(&lock_local);
+
+	if ((task = q->head[level]) != NULL) {
+		if ((q->head[level] = task->sched.next) == NULL)
+			q->tail[level] = NULL;
+
+		task->sched.next = NULL;
+		q->count -= 1;
+	}
+
+	spin_leave(&lock_local);
 
 	/*
-	 * The loop for finding the next task. There are four priority levels.
+	 * Clear the flag before the caller inspects the task state. Any
+	 * concurrent enqueue will either see the cleared flag or the
+	 * caller will see the updated task state.
 	 */
-	while ((search_task & 1) != 0 && search_task < 8) {
-		struct task *next_kernel = NULL;
-		struct task *next_high   = NULL;
-		struct task *next_normal = NULL;
-		struct task *next_low    = NULL;
+	if (task != NULL)
+		spin_unlock(&task->sched.queued);
 
-		next = start = current;
+	return task;
+}
 
-		while ((next = task_read_next(next)) && next != start) {
-			int priority;
-			uint32_t state;
+static struct task *dequeue_allowed(struct sched_queue *q, int level,
+	int cpu)
+{
+	struct task *task, *prev = NULL;
+	void *lock_local = &q->lock;
 
-			if (next->stopped) {
-				next->sched.state = 0;
-				continue;
-			}
+	spin_enter(&lock_local);
 
-			if (next->uniproc) {
-				next->sched.state = 0;
-				if (!task_switch(next)) {
-					spin_unlock(&current->sched.lock);
-					return;
-				}
-			}
+	task = q->head[level];
 
-			priority = next->sched.priority;
-			state = cpu_add32(&next->sched.state, 1);
+	while (task != NULL && !allowed(task, cpu)) {
+		prev = task;
+		task = task->sched.next;
+	}
 
-			if (priority == sched_priority_kernel) {
-				if (!task_check_event(next)) {
-					if (!next_kernel)
-						next_kernel = next;
-					if (next_kernel->sched.state < state)
-						next_kernel = next;
-				}
-			}
+	if (task != NULL) {
+		if (prev != NULL)
+			prev->sched.next = task->sched.next;
+		else
+			q->head[level] = task->sched.next;
 
-			if (next_kernel)
-				continue;
+		if (q->tail[level] == task)
+			q->tail[level] = prev;
 
-			if (priority == sched_priority_high) {
-				if (!task_check_event(next)) {
-					if (!next_high)
-						next_high = next;
-					if (next_high->sched.state < state)
-						next_high = next;
-				}
-			}
+		task->sched.next = NULL;
+		q->count -= 1;
+	}
 
-			if (next_high)
-				continue;
+	spin_leave(&lock_local);
 
-			if (priority == sched_priority_normal) {
-				if (!task_check_event(next)) {
-					if (!next_normal)
-						next_normal = next;
-					if (next_normal->sched.state < state)
-						next_normal = next;
-				}
-			}
+	if (task != NULL)
+		spin_unlock(&task->sched.queued);
 
-			if (next_normal)
-				continue;
+	return task;
+}
 
-			if (priority == sched_priority_low) {
-				if (!task_check_event(next)) {
-					if (!next_low)
-						next_low = next;
-					if (next_low->sched.state < state)
-						next_low = next;
-				}
-			}
-		}
+static struct task *steal(int cpu, int max_level, int *level)
+{
+	int i;
 
-		search_task += 1;
+	/*
+	 * Find work from other processors. The uniproc level is never
+	 * stolen, and the search starts from the next processor so that
+	 * idle processors do not all compete for the same queue.
+	 */
+	for (i = 1; i < sched_queue_count; i++) {
+		struct sched_queue *q;
+		struct task *task;
+		int j;
 
-		/*
-		 * Case: sched_priority_kernel
-		 */
-		if (next_kernel) {
-			next_kernel->sched.state = 0;
+		q = &sched_queue_array[(cpu + i) % sched_queue_count];
 
-			if (!task_switch(next_kernel)) {
-				spin_unlock(&current->sched.lock);
-				return;
-			}
+		if (cpu_read32(&q->count) == 0)
+			continue;
+
+		j = top_level(q, sched_level_kernel);
 
-			search_task += 1;
+		if (j > max_level)
 			continue;
+
+		if ((task = dequeue_allowed(q, j, cpu)) != NULL) {
+			*level = j;
+			return task;
 		}
+	}
 
-		if (current_runnable) {
-			if (current_priority == sched_priority_kernel)
-				break;
+	return NULL;
+}
+
+static int work_available(int cpu)
+{
+	int i;
+
+	/*
+	 * The uniprocessor tasks are run only by the bootstrap processor.
+	 */
+	for (i = 0; i < sched_queue_count; i++) {
+		const struct sched_queue *q = &sched_queue_array[i];
+		int first = sched_level_kernel;
+
+		if (i == 0 && cpu == 0)
+			first = sched_level_uniproc;
+
+		if (top_level(q, first) < sched_level_count)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void idle(struct task *current, struct sched_queue *q, int cpu)
+{
+	uint32_t count = 0;
+	int r;
+
+	/*
+	 * The periodic timer interrupts are needed if the I/O APIC is
+	 * not enabled or if the task is polling its event functions.
+	 */
+	if (!kernel->io_apic_enabled) {
+		task_idle();
+		return;
+	}
+
+	if (!current->stopped) {
+		if (cpu_read32(&current->sched.blocked) != task_block_wakeup) {
+			task_idle();
+			return;
 		}
+	}
 
+	if ((cpu_read_flags() & CPU_INTERRUPT_FLAG) == 0)
+		return;
+
+	r = cpu_ints(0);
+	cpu_write32(&q->idle, 1);
+
+	/*
+	 * The run queues are checked after setting the idle flag. If
+	 * a task is enqueued later, this processor will be woken up.
+	 */
+	if (!work_available(cpu)) {
 		/*
-		 * Case: sched_priority_high
+		 * The local APIC timer of the bootstrap processor is used
+		 * for the one-shot timers, so it is not stopped.
 		 */
-		if (next_high) {
-			next_high->sched.state = 0;
+		if (cpu != 0) {
+			count = apic_read(0x380);
+			apic_write(0x380, 0);
+		}
 
-			if (!task_switch(next_high)) {
-				spin_unlock(&current->sched.lock);
-				return;
-			}
+		if (kernel->cpu_feature.monitor)
+			cpu_idle_monitor(&q->idle, 1);
+		else
+			cpu_idle();
 
-			search_task += 1;
-			continue;
-		}
+		cpu_ints(0);
+
+		if (cpu != 0)
+			apic_write(0x380, count);
+	}
+
+	cpu_write32(&q->idle, 0);
+	cpu_ints(r);
+}
+
+static int keep_realtime(const struct sched_queue *q,
+	const struct task *current)
+{
+	const struct task *task = q->head[sched_level_realtime];
+	int priority = current->sched.rt_priority;
+
+	/*
+	 * The FIFO tasks run until a higher priority task is runnable,
+	 * and the round-robin tasks also give turns to the tasks that
+	 * have the same priority. The task structures are never freed,
+	 * so reading the priority without locking the queue is safe.
+	 */
+	if (task_level(current) != sched_level_realtime || task == NULL)
+		return 0;
 
-		if (current_runnable) {
-			if (current_priority == sched_priority_high)
+	if (current->sched.policy == sched_policy_fifo)
+		return (task->sched.rt_priority <= priority);
+
+	return (task->sched.rt_priority < priority);
+}
+
+static void yield(void)
+{
+	struct task *current = task_current();
+	struct gdt_data *data;
+	struct sched_queue *q;
+	int current_runnable, current_level;
+	int cpu, first, i, starved;
+
+	if (!spin_trylock(&current->sched.lock))
+		return;
+
+	/*
+	 * Expire the timers if the one-shot timer interrupt is late or
+	 * not available at all.
+	 */
+	timer_expire();
+
+	/*
+	 * The current task can not be switched to another processor
+	 * before calling task_switch, so the processor number is valid.
+	 */
+	data = gdt_get_data();
+	cpu = data->cpu;
+
+	if ((q = data->sched) == NULL) {
+		q = &sched_queue_array[cpu];
+		q->apic_id = data->apic_id;
+		cpu_write32((uint32_t *)&q->apic_ready, 1);
+		data->sched = q;
+	}
+
+	current->sched.cpu = cpu;
+	current_runnable = !current->stopped && !task_check_event(NULL);
+
+	if (current->sched.blocked == task_block_wakeup)
+		current_runnable = 0;
+	current_level = task_level(current);
+
+	/*
+	 * Make sure that all tasks will get a chance to run. Every 32nd
+	 * call gives the turn to one of the lower priority levels.
+	 */
+	starved = ((cpu_add32(&q->yield_count, 1) & 0x1F) == 0);
+	first = (cpu == 0) ? sched_level_uniproc : sched_level_kernel;
+
+	/*
+	 * The number of attempts is limited. Tasks that are waiting for
+	 * their event functions are moved to the tail of the queue.
+	 */
+	for (i = 0; i < SCHED_ATTEMPTS; i++) {
+		int level = top_level(q, first);
+		struct task *next = NULL;
+
+		if (starved && q->head[q->starved_level] != NULL) {
+			level = q->starved_level;
+
+		} else if (current_runnable && level >= current_level) {
+			if (level > current_level || keep_realtime(q, current))
 				break;
 		}
 
-		/*
-		 * Case: sched_priority_normal
-		 */
-		if (next_normal) {
-			next_normal->sched.state = 0;
+		if (starved) {
+			if (++q->starved_level >= sched_level_count)
+				q->starved_level = sched_level_high;
+			starved = 0;
+		}
 
-			if (!task_switch(next_normal)) {
-				spin_unlock(&current->sched.lock);
-				return;
-			}
+		if (level < sched_level_count)
+			next = dequeue(q, level);
 
-			search_task += 1;
-			continue;
-		}
+		if (!next) {
+			int max_level = sched_level_low;
 
-		if (current_runnable) {
-			if (current_priority == sched_priority_normal)
+			if (current_runnable)
+				max_level = current_level - 1;
+
+			if ((next = steal(cpu, max_level, &level)) == NULL)
 				break;
+
+			next->sched.cpu = cpu;
 		}
 
+		if (next == current || next->stopped)
+			continue;
+
 		/*
-		 * Case: sched_priority_low
+		 * The affinity mask may have been changed after the task
+		 * was enqueued. The enqueue function moves the task.
 		 */
-		if (next_low) {
-			next_low->sched.state = 0;
-
-			if (!task_switch(next_low)) {
-				spin_unlock(&current->sched.lock);
-				return;
-			}
-
-			search_task += 1;
+		if (!allowed(next, cpu)) {
+			enqueue(next);
 			continue;
 		}
 
-		if (current_runnable) {
-			if (current_priority == sched_priority_low)
-				break;
+		if (cpu_read32(&next->sched.blocked) == task_block_wakeup)
+			continue;
+
+		enqueue(current);
+		q->running_rank = task_rank(next);
+
+		if (!task_switch(next)) {
+			spin_unlock(&current->sched.lock);
+			return;
 		}
+
+		q->running_rank = task_rank(current);
+		enqueue(next);
 	}
 
 	/*
@@ -245,7 +639,147 @@ static void yield(void)
 	 * this current task can't be run either.
 	 */
 	if (!current_runnable)
-		task_idle();
+		idle(current, q, cpu);
 
 	spin_unlock(&current->sched.lock);
 }
+
+static void preempt(void)
+{
+	struct task *current = task_current();
+	struct sched_queue *q;
+	struct task *next;
+	int cpu;
+
+	/*
+	 * This is called from the reschedule interrupt handler. Task
+	 * switching may be disabled, or the current task may be in the
+	 * middle of the yield function.
+	 */
+	if (current->asm_data1 > 1)
+		return;
+
+	if (!spin_trylock(&current->sched.lock))
+		return;
+
+	cpu = gdt_get_cpu();
+	q = &sched_queue_array[cpu];
+	next = q->head[sched_level_realtime];
+
+	if (next == NULL || task_rank(next) <= task_rank(current)) {
+		spin_unlock(&current->sched.lock);
+		return;
+	}
+
+	if ((next = dequeue(q, sched_level_realtime)) != NULL) {
+		if (next->stopped)
+			next = NULL;
+
+		else if (cpu_read32(&next->sched.blocked) == task_block_wakeup)
+			next = NULL;
+
+		else if (!allowed(next, cpu))
+			enqueue(next), next = NULL;
+	}
+
+	if (next != NULL) {
+		enqueue(current);
+		q->running_rank = task_rank(next);
+
+		if (task_switch(next)) {
+			q->running_rank = task_rank(current);
+			enqueue(next);
+		}
+	}
+
+	spin_unlock(&current->sched.lock);
+}
+
+static int remove_queued(struct task *task)
+{
+	int i, level;
+
+	/*
+	 * The task is searched from all run queues, because the queue
+	 * is not necessarily the one of the processor it ran last.
+	 */
+	for (i = 0; i < sched_queue_count; i++) {
+		struct sched_queue *q = &sched_queue_array[i];
+		void *lock_local = &q->lock;
+		int found = 0;
+
+		spin_enter(&lock_local);
+
+		for (level = 0; !found && level < sched_level_count; level++) {
+			struct task *prev = NULL, *t = q->head[level];
+
+			while (t != NULL && t != task)
+				prev = t, t = t->sched.next;
+
+			if (t == NULL)
+				continue;
+
+			if (prev != NULL)
+				prev->sched.next = t->sched.next;
+			else
+				q->head[level] = t->sched.next;
+
+			if (q->tail[level] == t)
+				q->tail[level] = prev;
+
+			t->sched.next = NULL;
+			q->count -= 1;
+			found = 1;
+		}
+
+		spin_leave(&lock_local);
+
+		if (found) {
+			spin_unlock(&task->sched.queued);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int sched_set_policy(struct task *task, int policy, int priority)
+{
+	const int min = SCHED_RT_PRIORITY_MIN;
+	const int max = SCHED_RT_PRIORITY_MAX;
+	int queued;
+
+	if (policy == sched_policy_other) {
+		if (priority != 0)
+			return DE_ARGUMENT;
+
+	} else if (policy == sched_policy_fifo || policy == sched_policy_rr) {
+		if (priority < min || priority > max)
+			return DE_ARGUMENT;
+
+	} else {
+		return DE_ARGUMENT;
+	}
+
+	/*
+	 * The task may be on a run queue even if it is the current task,
+	 * e.g. after a failed task switch. The level and the order of the
+	 * real-time tasks depend on the policy and the priority, so the
+	 * task is removed before the change and enqueued again. If the
+	 * queued flag is set but the task was not found, an enqueue or
+	 * a dequeue function is in progress.
+	 */
+	while ((queued = remove_queued(task)) == 0) {
+		if (!cpu_read32(&task->sched.queued))
+			break;
+		task_yield();
+	}
+
+	task->sched.rt_priority = priority;
+	task->sched.policy = policy;
+
+	if (queued)
+		enqueue(task);
+
+	return 0;
+}
@@ -956,23 +956,68 @@ int file_realpath(const char *name, void *buffer, size_t size)
 	return r;
 }
 
+#define POLL_STATIC_ENTRIES 8
+
+static void poll_watch(int nfds,
+	struct vfs_node **nodes, struct waitq_entry *entries, int watch)
+{
+	int i;
+
+	for (i = 0; i < nfds; i++) {
+		struct vfs_node *node = nodes[i];
+
+		if (node == NULL)
+			continue;
+
+		if (watch) {
+			event_watch(*node->internal_event, &entries[i]);
+			continue;
+		}
+
+		event_unwatch(*node->internal_event, &entries[i]);
+		node->n_release(&node);
+		nodes[i] = NULL;
+	}
+}
+
 int file_poll(struct pollfd fds[], int nfds, int timeout, int *retval)
 {
+	const uint64_t slice_ns = 100000000;
 	struct task *task = task_current();
-	uint64_t start = timer_read();
+	struct vfs_node *static_nodes[POLL_STATIC_ENTRIES];
+	struct waitq_entry static_entries[POLL_STATIC_ENTRIES];
+	struct vfs_node **nodes = &static_nodes[0];
+	struct waitq_entry *entries = &static_entries[0];
+	uint64_t start = timer_read_ns();
 	uint64_t end = 0;
 	int i, r = 0;
 
 	if (timeout >= 0)
-		end = start + (uint64_t)timeout;
+		end = start + (uint64_t)timeout * 1000000;
+
+	if (nfds > POLL_STATIC_ENTRIES) {
+		nodes = malloc((size_t)nfds * sizeof(*nodes));
+		entries = malloc((size_t)nfds * sizeof(*entries));
+
+		if (nodes == NULL || entries == NULL) {
+			free(nodes), free(entries);
+			return (*retval = 0), DE_MEMORY;
+		}
+	}
+
+	for (;;) {
+		uint64_t deadline;
+		int polled = 0;
 
-	do {
 		for (i = 0; i < nfds; i++) {
 			int fd = fds[i].fd;
 			int events = (int)fds[i].events;
 			int revents = POLLNVAL;
+			int watch = 0;
 			uint32_t t = 0;
 
+			nodes[i] = NULL;
+
 			if (fd < 0) {
 				fds[i].revents = 0;
 				continue;
@@ -989,8 +1034,25 @@ int file_poll(struct pollfd fds[], int nfds, int timeout, int *retval)
 
 				lock_fte(fte);
 
-				if ((node = fte->node) != NULL)
+				if ((node = fte->node) != NULL) {
 					node->n_poll(node, events, &revents);
+					watch = (node->internal_event != NULL);
+				}
+
+				/*
+				 * The internal events are signaled when there
+				 * is new data to read. Other nodes are polled.
+				 */
+				if ((events & POLLOUT) != 0)
+					watch = 0;
+
+				if (watch) {
+					vfs_increment_count(node);
+					nodes[i] = node;
+					entries[i].linked = 0;
+				} else {
+					polled = 1;
+				}
 
 				unlock_fte(fte);
 			}
@@ -1002,12 +1064,56 @@ int file_poll(struct pollfd fds[], int nfds, int timeout, int *retval)
 		if (r != 0 || timeout == 0)
 			break;
 
-		if (detect_interrupt(0))
-			return (*retval = 0), DE_INTERRUPT;
+		if (detect_interrupt(0)) {
+			r = DE_INTERRUPT;
+			break;
+		}
+
+		/*
+		 * Block until one of the internal events is signaled or
+		 * the deadline expires. The nodes that do not have events
+		 * are polled every millisecond, and the pending signals
+		 * are checked at least every 100 ms.
+		 */
+		deadline = timer_read_ns() + (polled ? 1000000 : slice_ns);
 
-		cpu_halt(1);
+		if (timeout >= 0 && deadline > end)
+			deadline = end;
 
-	} while (timeout < 0 || timer_read() < end);
+		task_block_prepare(deadline);
+		poll_watch(nfds, nodes, entries, 1);
+
+		for (i = 0; i < nfds; i++) {
+			int events = (int)fds[i].events;
+			int revents = 0;
+
+			if (nodes[i] == NULL)
+				continue;
+
+			nodes[i]->n_poll(nodes[i], events, &revents);
+
+			if (revents != 0)
+				break;
+		}
+
+		if (i == nfds)
+			task_block();
+		else
+			task_block_cancel();
+
+		poll_watch(nfds, nodes, entries, 0);
+
+		if (timeout >= 0 && timer_read_ns() >= end)
+			break;
+	}
+
+	poll_watch(nfds, nodes, entries, 0);
+
+	if (nodes != &static_nodes[0])
+		free(nodes), free(entries);
+
+	if (r < 0)
+		return (*retval = 0), r;
 
 	*retval = r;
 
@@ -1041,6 +1147,45 @@ int file_ioctl(int fd, int request, long long arg)
 	return DE_ARGUMENT;
 }
 
+int file_mmap(int fd, addr_t vaddr, size_t size,
+	uint64_t offset, int type, int shared)
+{
+	struct task *task = task_current();
+	int r;
+
+	if (fd >= 0 && fd < (int)task->fd.state) {
+		struct file_table_entry *fte;
+		struct vfs_node *n;
+		uint32_t t;
+		int f;
+
+		if ((t = task->fd.table[fd]) != 0) {
+			fte = (void *)((addr_t)(t & table_mask));
+
+			lock_fte(fte);
+
+			n = fte->node;
+			f = fte->flags & O_ACCMODE;
+
+			if (n->type != vfs_type_regular)
+				r = DE_TYPE;
+			else if (f == O_WRONLY)
+				r = DE_ACCESS;
+			else if (shared && !(type & pg_readonly) && f != O_RDWR)
+				r = DE_ACCESS;
+			else
+				r = pg_file_map(vaddr, size,
+					n, offset, type, shared);
+
+			unlock_fte(fte);
+
+			return r;
+		}
+	}
+
+	return DE_ARGUMENT;
+}
+
 int file_openpty(int fd[2], char name[16],
 	const struct __dancy_termios *termios_p,
 	const struct __dancy_winsize *winsize_p)
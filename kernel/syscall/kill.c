@@ -130,7 +130,17 @@ int kill_internal(__dancy_pid_t pid, int sig, int flags)
 		a.r = 0;
 
 	if (allowed_signal(sig) && flags == 0) {
-		task_foreach(f, &a);
+		uint64_t id_group = a.current->id_group;
+
+		if (pid > 0)
+			task_foreach_id((uint64_t)pid, f, &a);
+		else if (pid < -1)
+			task_foreach_group((uint64_t)(-pid), f, &a);
+		else if (pid == 0)
+			task_foreach_group(id_group, f, &a);
+		else
+			task_foreach(f, &a);
+
 		return a.r;
 	}
 
@@ -52,7 +52,7 @@ int getpgid_internal(uint64_t id, uint64_t *id_group)
 	*(arg.id_group = id_group) = 0;
 	arg.id_session = NULL;
 
-	task_foreach(id_internal_func, &arg);
+	task_foreach_id(id, id_internal_func, &arg);
 
 	if (*id_group == 0)
 		return DE_SEARCH;
@@ -72,10 +72,58 @@ int getsid_internal(uint64_t id, uint64_t *id_session)
 	arg.id_group = NULL;
 	*(arg.id_session = id_session) = 0;
 
-	task_foreach(id_internal_func, &arg);
+	task_foreach_id(id, id_internal_func, &arg);
 
 	if (*id_session == 0)
 		return DE_SEARCH;
 
 	return 0;
 }
+
+struct affinity_internal_arg {
+	uint64_t id;
+	uint64_t mask;
+	int r;
+};
+
+static int affinity_internal_func(struct task *task, void *arg)
+{
+	struct affinity_internal_arg *a = arg;
+	struct task *current = task_current();
+
+	if (task->id != a->id)
+		return 0;
+
+	if (current->id_session != 1) {
+		if (task->id_session != current->id_session)
+			return (a->r = DE_ACCESS), 1;
+	}
+
+	cpu_write64(&task->sched.affinity, a->mask);
+
+	return (a->r = 0), 1;
+}
+
+int setaffinity_internal(uint64_t id, uint64_t mask)
+{
+	struct affinity_internal_arg arg;
+	int count = kernel->smp_ap_count + 1;
+	uint64_t all = 0xFFFFFFFFFFFFFFFFull;
+
+	if (count < 64)
+		all = ((uint64_t)1 << count) - 1;
+
+	if ((mask &= all) == 0)
+		return DE_ARGUMENT;
+
+	if (id == 0)
+		task_identify(&id, NULL, NULL, NULL);
+
+	arg.id = id;
+	arg.mask = (mask != all) ? mask : 0;
+	arg.r = DE_SEARCH;
+
+	task_foreach_id(id, affinity_internal_func, &arg);
+
+	return arg.r;
+}
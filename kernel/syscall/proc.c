@@ -181,6 +181,47 @@ static int f2(struct task *task, void *arg)
 		return (a->r = 0), 1;
 	}
 
+	if (a->request == __DANCY_PROCINFO_CPU_TIME) {
+		struct __dancy_cpu_time cpu_time;
+		uint64_t ns[4];
+
+		if (a->size[1] < sizeof(cpu_time))
+			return (a->r = DE_MEMORY), 1;
+
+		task_read_cpu_time(task, &ns[0], &ns[1], &ns[2]);
+
+		cpu_time.user_ns = ns[0];
+		cpu_time.system_ns = ns[1];
+		cpu_time.child_user_ns = ns[2];
+		cpu_time.child_system_ns = ns[3];
+		cpu_time.switches = task->cpu.switches;
+		cpu_time.wakeups = task->cpu.wakeups;
+
+		memcpy(a->out, &cpu_time, sizeof(cpu_time));
+		a->size[0] +=  sizeof(cpu_time);
+
+		return (a->r = 0), 1;
+	}
+
+	if (a->request == __DANCY_PROCINFO_AFFINITY) {
+		uint64_t mask = cpu_read64(&task->sched.affinity);
+		int count = kernel->smp_ap_count + 1;
+
+		if (a->size[1] < sizeof(mask))
+			return (a->r = DE_MEMORY), 1;
+
+		if (mask == 0) {
+			mask = 0xFFFFFFFFFFFFFFFFull;
+			if (count < 64)
+				mask = ((uint64_t)1 << count) - 1;
+		}
+
+		memcpy(a->out, &mask, sizeof(mask));
+		a->size[0] +=  sizeof(mask);
+
+		return (a->r = 0), 1;
+	}
+
 	if (a->request == __DANCY_PROCINFO_SMP_AP_COUNT) {
 		int smp_ap_count = kernel->smp_ap_count;
 
@@ -196,11 +237,77 @@ static int f2(struct task *task, void *arg)
 	return (a->r = DE_ARGUMENT), 1;
 }
 
+static int procinfo_block_cache(size_t *size, void *out)
+{
+	struct __dancy_block_cache entry;
+	struct bcache_stat stat;
+	size_t offset = 0;
+	int i;
+
+	/*
+	 * The statistics of the block cache are returned for all the
+	 * devices that have been used (see bcache.c).
+	 */
+	for (i = 0; i < BCACHE_DEVICES; i++) {
+		if (bcache_stat(i, &stat) != 0)
+			continue;
+
+		if (*size - offset < sizeof(entry))
+			return (*size = 0), DE_MEMORY;
+
+		entry.device = (unsigned long long)i;
+		entry.hits = stat.hits;
+		entry.misses = stat.misses;
+		entry.blocks = stat.blocks;
+		entry.block_size = stat.block_size;
+
+		memcpy((unsigned char *)out + offset, &entry, sizeof(entry));
+		offset += sizeof(entry);
+	}
+
+	return (*size = offset), 0;
+}
+
+static int procinfo_heap_cache(size_t *size, void *out)
+{
+	struct __dancy_heap_cache entry;
+	struct heap_cache_stat stat;
+	size_t offset = 0;
+	int i;
+
+	/*
+	 * The statistics of the slab caches are returned in the order
+	 * of the object sizes (see heap.c).
+	 */
+	for (i = 0; heap_cache_stat(i, &stat) == 0; i++) {
+		if (*size - offset < sizeof(entry))
+			return (*size = 0), DE_MEMORY;
+
+		entry.object_size = (unsigned long long)stat.object_size;
+		entry.slabs = (unsigned long long)stat.slab_count;
+		entry.objects = (unsigned long long)stat.object_count;
+		entry.free_objects = (unsigned long long)stat.free_count;
+		entry.magazine_objects =
+		    (unsigned long long)stat.magazine_count;
+
+		memcpy((unsigned char *)out + offset, &entry, sizeof(entry));
+		offset += sizeof(entry);
+	}
+
+	return (*size = offset), 0;
+}
+
 int procinfo_internal(__dancy_pid_t id, int request, size_t *size, void *out)
 {
 	struct f2_arg _a;
 	struct f2_arg *a = &_a;
 
+	if (request == __DANCY_PROCINFO_BLOCK_CACHE)
+		return procinfo_block_cache(size, out);
+
+	if (request == __DANCY_PROCINFO_HEAP_CACHE)
+		return procinfo_heap_cache(size, out);
+
 	a->id = id;
 	a->request = request;
 	a->size[0] = 0;
@@ -208,7 +315,7 @@ int procinfo_internal(__dancy_pid_t id, int request, size_t *size, void *out)
 	a->out = out;
 	a->r = DE_SEARCH;
 
-	task_foreach(f2, a);
+	task_foreach_id((uint64_t)id, f2, a);
 
 	if (a->r != 0) {
 		if (*size != 0 && a->r != DE_ARGUMENT)
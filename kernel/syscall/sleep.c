@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, 2024 Antti Tiihala
+ * Copyright (c) 2023, 2024, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -19,45 +19,36 @@
 
 #include <dancy.h>
 
-static int f(uint64_t *data)
+static int s(uint64_t start_ns, uint64_t request_ns, struct timespec *remain)
 {
-	uint64_t t = timer_read();
-
-	if (t > data[0])
-		return 0;
-
-	return ((t - data[1]) < 100);
-}
-
-static int s(uint64_t start_ms, uint64_t request_ms, struct timespec *remain)
-{
-	uint64_t d0 = start_ms + request_ms;
+	const uint64_t check_ns = 100000000;
+	uint64_t d0 = start_ns + request_ns;
 	uint64_t d1 = 0;
 	int r = 0;
 
-	if (d0 < start_ms)
+	if (d0 < start_ns)
 		d0 = (uint64_t)(ULLONG_MAX);
 
-	while (d0 > (d1 = timer_read())) {
+	while (d0 > (d1 = timer_read_ns())) {
 		if (task_signaled(task_current())) {
 			r = DE_INTERRUPT;
 			break;
 		}
 
-		task_write_event(f, d0, d1);
-
-		do {
-			task_yield();
-		} while (task_read_event());
+		/*
+		 * Check the pending signals at least every 100 ms.
+		 */
+		task_block_prepare((d0 - d1) > check_ns ? d1 + check_ns : d0);
+		task_block();
 	}
 
 	if (r == DE_INTERRUPT && remain != NULL) {
-		uint64_t ms64 = d0 - d1;
+		uint64_t ns64 = d0 - d1;
 
 		memset(remain, 0, sizeof(*remain));
 
-		remain->tv_sec = (time_t)(ms64 / 1000);
-		remain->tv_nsec = (long)(ms64 % 1000) * 1000000L;
+		remain->tv_sec = (time_t)(ns64 / 1000000000);
+		remain->tv_nsec = (long)(ns64 % 1000000000);
 	}
 
 	return r;
@@ -66,8 +57,8 @@ static int s(uint64_t start_ms, uint64_t request_ms, struct timespec *remain)
 int sleep_internal(clockid_t id, int flags,
 	const struct timespec *request,  struct timespec *remain)
 {
-	uint64_t start_ms = timer_read();
-	uint64_t request_ms;
+	uint64_t start_ns = timer_read_ns();
+	uint64_t request_ns;
 
 	if (id != CLOCK_REALTIME && id != CLOCK_MONOTONIC)
 		return DE_UNSUPPORTED;
@@ -78,54 +69,42 @@ int sleep_internal(clockid_t id, int flags,
 	if (request->tv_sec < 0 || request->tv_nsec < 0)
 		return DE_ARGUMENT;
 
-	if ((unsigned long long)request->tv_sec < 0x0000FFFFFFFFFFFFull) {
-		request_ms = (uint64_t)(request->tv_sec * 1000);
-		request_ms += (uint64_t)(request->tv_nsec / 1000000);
+	if ((unsigned long long)request->tv_sec < 0x00000003FFFFFFFFull) {
+		request_ns = (uint64_t)request->tv_sec * 1000000000;
+		request_ns += (uint64_t)request->tv_nsec;
 	} else {
-		request_ms = (uint64_t)(ULLONG_MAX);
+		request_ns = (uint64_t)(ULLONG_MAX);
 	}
 
-	if (request_ms < 2)
-		request_ms = 2;
-
 	if (flags == 0)
-		return s(start_ms, request_ms, remain);
+		return s(start_ns, request_ns, remain);
 
 	while ((flags & TIMER_ABSTIME) != 0) {
-		uint64_t ms64 = 0;
-		struct timespec t;
-		time_t d;
+		uint64_t ns64 = 0;
+		int r;
 
 		if (id == CLOCK_REALTIME)
-			ms64 = (uint64_t)epoch_read_ms();
+			ns64 = (uint64_t)epoch_read_ms() * 1000000;
 		else
-			ms64 = (uint64_t)timer_read();
+			ns64 = (uint64_t)timer_read() * 1000000;
 
-		memset(&t, 0, sizeof(t));
-
-		t.tv_sec = (time_t)(ms64 / 1000);
-		t.tv_nsec = (long)(ms64 % 1000) * 1000000L;
-
-		if (request->tv_sec < t.tv_sec)
+		if (request_ns <= ns64)
 			break;
 
-		d = request->tv_sec - t.tv_sec;
-
-		if (d > 0) {
-			start_ms = timer_read();
-			request_ms = (uint64_t)((d > 1) ? 1000 : 10);
+		if (task_signaled(task_current()))
+			return DE_INTERRUPT;
 
-			if (task_signaled(task_current()))
-				return DE_INTERRUPT;
+		/*
+		 * The realtime clock can be adjusted, so the clock is
+		 * read again at least every second.
+		 */
+		ns64 = request_ns - ns64;
 
-			s(start_ms, request_ms, NULL);
-			continue;
-		}
-
-		if (request->tv_nsec <= t.tv_nsec)
-			break;
+		if (ns64 > 1000000000)
+			ns64 = 1000000000;
 
-		task_yield();
+		if ((r = s(timer_read_ns(), ns64, NULL)) != 0)
+			return r;
 	}
 
 	return 0;
@@ -38,8 +38,7 @@ static void func_setsid(struct task *current, void *arg)
 	uint64_t id = current->id;
 
 	(void)arg;
-	current->id_group = id;
-	current->id_session = id;
+	task_set_group(current, id, id);
 }
 
 static void func_setsigmask(struct task *current, void *arg)
@@ -75,7 +74,7 @@ static int func_setpgroup(struct task *task, void *arg)
 	if (current->id_session == current->id && current->id_group != pgroup)
 		return (ta->setpgroup_retval = DE_ACCESS);
 
-	current->id_group = pgroup;
+	task_set_group(current, pgroup, current->id_session);
 
 	return 0;
 }
@@ -83,6 +82,7 @@ static int func_setpgroup(struct task *task, void *arg)
 static int new_task(void *arg)
 {
 	struct task_arg *ta = arg;
+	struct task *current = task_current();
 	addr_t user_ip, user_sp;
 	int i, r = 0;
 
@@ -98,8 +98,13 @@ static int new_task(void *arg)
 		}
 
 		if ((flags & __DANCY_SPAWN_SETPGROUP) != 0) {
+			uint64_t pgroup = (uint64_t)ta->attrp->_pgroup;
+
+			if (pgroup == 0)
+				pgroup = task_current()->id;
+
 			flags ^= __DANCY_SPAWN_SETPGROUP;
-			task_foreach(func_setpgroup, arg);
+			task_foreach_group(pgroup, func_setpgroup, arg);
 
 			if (ta->setpgroup_retval != 0) {
 				ta->retval = ta->setpgroup_retval;
@@ -116,6 +121,36 @@ static int new_task(void *arg)
 			task_access(func_setsigmask, &ta->attrp->_sigmask);
 		}
 
+		if ((flags & __DANCY_SPAWN_SETSCHEDULER) != 0) {
+			int policy = ta->attrp->_sched[1];
+			int priority = ta->attrp->_sched[0];
+
+			flags ^= __DANCY_SPAWN_SETSCHEDULER;
+			flags &= ~__DANCY_SPAWN_SETSCHEDPARAM;
+
+			if (sched_set_policy(current, policy, priority) != 0)
+				r = DE_ARGUMENT;
+		}
+
+		if ((flags & __DANCY_SPAWN_SETSCHEDPARAM) != 0) {
+			int policy = current->sched.policy;
+			int priority = ta->attrp->_sched[0];
+
+			flags ^= __DANCY_SPAWN_SETSCHEDPARAM;
+
+			if (sched_set_policy(current, policy, priority) != 0)
+				r = DE_ARGUMENT;
+		}
+
+		if ((flags & __DANCY_SPAWN_SETAFFINITY_NP) != 0) {
+			uint64_t mask = (uint64_t)ta->attrp->_affinity;
+
+			flags ^= __DANCY_SPAWN_SETAFFINITY_NP;
+
+			if (setaffinity_internal(0, mask) != 0)
+				r = DE_ARGUMENT;
+		}
+
 		if (flags != 0)
 			r = DE_ARGUMENT;
 	}
@@ -51,6 +51,16 @@ static long long dancy_syscall_time(va_list va)
 		r = (long long)(ms64 / 1000);
 		t.tv_sec = (time_t)r;
 		t.tv_nsec = (long)(ms64 % 1000) * 1000000L;
+
+	} else if (id == CLOCK_PROCESS_CPUTIME_ID) {
+		uint64_t user_ns, system_ns, ns64;
+
+		task_read_cpu_time(task_current(), &user_ns, &system_ns, NULL);
+		ns64 = user_ns + system_ns;
+
+		r = (long long)(ns64 / 1000000000);
+		t.tv_sec = (time_t)r;
+		t.tv_nsec = (long)(ns64 % 1000000000);
 	}
 
 	if (r >= 0 && tp != NULL) {
@@ -808,18 +818,70 @@ static long long dancy_syscall_mmap(va_list va)
 		return -EINVAL;
 
 	flags = (unsigned int)options->_flags;
+
+	/*
+	 * The file mappings use the file descriptor and the offset.
+	 */
+	if ((flags & __DANCY_MAP_ANONYMOUS) == 0) {
+		int shared = (flags & __DANCY_MAP_SHARED) != 0;
+		int type = 0, r;
+
+		flags ^= ((unsigned int)__DANCY_MAP_FIXED);
+		flags &= (~((unsigned int)__DANCY_MAP_PRIVATE));
+		flags &= (~((unsigned int)__DANCY_MAP_SHARED));
+
+		if (flags != 0)
+			return -ENOTSUP;
+
+		if (shared == ((options->_flags & __DANCY_MAP_PRIVATE) != 0))
+			return -EINVAL;
+
+		if ((vaddr = (addr_t)address) < 0x10000000)
+			return -ENOTSUP;
+
+		if (options->_offset < 0 || (options->_offset & 0xFFF) != 0)
+			return -EINVAL;
+
+		if ((options->_prot & __DANCY_PROT_WRITE) == 0)
+			type |= pg_readonly;
+
+		if ((options->_prot & __DANCY_PROT_EXEC) == 0)
+			type |= pg_noexec;
+
+		r = file_mmap(options->_fd, vaddr, size,
+			(uint64_t)options->_offset, type, shared);
+
+		if (r != 0) {
+			if (r == DE_ARGUMENT)
+				return -EBADF;
+			if (r == DE_TYPE)
+				return -ENODEV;
+			if (r == DE_ACCESS)
+				return -EACCES;
+			if (r == DE_ALIGNMENT)
+				return -EINVAL;
+			if (r == DE_WRITE)
+				return -EIO;
+			return -ENOMEM;
+		}
+
+		return (long long)vaddr;
+	}
+
 	flags ^= ((unsigned int)__DANCY_MAP_ANONYMOUS);
 	flags ^= ((unsigned int)__DANCY_MAP_PRIVATE);
 	flags ^= ((unsigned int)__DANCY_MAP_FIXED);
+	flags &= (~((unsigned int)__DANCY_MAP_ARCTIC));
+	flags &= (~((unsigned int)__DANCY_MAP_HUGETLB));
 
-	if (flags != 0 && flags != __DANCY_MAP_ARCTIC)
+	if (flags != 0)
 		return -ENOTSUP;
 
 	if ((vaddr = (addr_t)address) < 0x10000000)
 		return -ENOTSUP;
 
 	{
-		int type = 0;
+		int type = pg_lazy, r;
 
 		if ((options->_prot & __DANCY_PROT_WRITE) == 0)
 			type |= pg_readonly;
@@ -830,6 +892,21 @@ static long long dancy_syscall_mmap(va_list va)
 		if ((options->_flags & __DANCY_MAP_ARCTIC) != 0)
 			type |= pg_arctic;
 
+		if ((options->_flags & __DANCY_MAP_HUGETLB) != 0)
+			type |= pg_large;
+
+		/*
+		 * The file mappings in the range are removed first, and
+		 * the dirty pages of the shared mappings are written.
+		 */
+		if ((r = pg_file_unmap(vaddr, size)) != 0) {
+			if (r == DE_ARGUMENT)
+				return -EINVAL;
+			if (r == DE_WRITE)
+				return -EIO;
+			return -ENOMEM;
+		}
+
 		if ((addr_t)pg_map_user(vaddr, size, type) != vaddr)
 			return -ENOMEM;
 	}
@@ -841,10 +918,23 @@ static long long dancy_syscall_munmap(va_list va)
 {
 	void *address = va_arg(va, void *);
 	size_t size = va_arg(va, size_t);
+	int r;
 
 	if ((addr_t)address < 0x10000000 || size == 0)
 		return -EINVAL;
 
+	/*
+	 * The pages are not unmapped if the file mappings could not
+	 * be removed, e.g. the dirty pages were not written.
+	 */
+	if ((r = pg_file_unmap((addr_t)address, size)) != 0) {
+		if (r == DE_ARGUMENT)
+			return -EINVAL;
+		if (r == DE_WRITE)
+			return -EIO;
+		return -ENOMEM;
+	}
+
 	if (pg_unmap_user((addr_t)address, size))
 		return -EINVAL;
 
@@ -878,7 +968,8 @@ static long long dancy_syscall_mprotect(va_list va)
 	if (prot != 0)
 		return -ENOTSUP;
 
-	pg_protect_user((addr_t)address, size, type);
+	if (pg_protect_user((addr_t)address, size, type))
+		return -ENOMEM;
 
 	return 0;
 }
@@ -892,7 +983,7 @@ static long long dancy_syscall_msync(va_list va)
 	int ms_async = (flags & __DANCY_MS_ASYNC) ? 1 : 0;
 	int ms_sync = (flags & __DANCY_MS_SYNC) ? 1 : 0;
 
-	if ((addr_t)address < 0x80000000)
+	if ((addr_t)address < 0x10000000 || ((addr_t)address & 0xFFF) != 0)
 		return -EINVAL;
 
 	flags &= (~((unsigned int)__DANCY_MS_ASYNC));
@@ -905,6 +996,9 @@ static long long dancy_syscall_msync(va_list va)
 	if (size && pg_check_user_read(address, size))
 		return -ENOMEM;
 
+	if (size && pg_file_sync((addr_t)address, size))
+		return -EIO;
+
 	return 0;
 }
 
@@ -1352,6 +1446,38 @@ static long long dancy_syscall_arctic(va_list va)
 	return 0;
 }
 
+static long long dancy_syscall_yield(va_list va)
+{
+	(void)va;
+
+	task_yield();
+
+	return 0;
+}
+
+static long long dancy_syscall_setaffinity(va_list va)
+{
+	__dancy_pid_t pid = va_arg(va, __dancy_pid_t);
+	const unsigned long long *mask = va_arg(va, const unsigned long long *);
+	int r;
+
+	if (pid < 0)
+		return -EINVAL;
+
+	if (pg_check_user_read(mask, sizeof(*mask)))
+		return -EFAULT;
+
+	if ((r = setaffinity_internal((uint64_t)pid, (uint64_t)*mask)) != 0) {
+		if (r == DE_SEARCH)
+			return -ESRCH;
+		if (r == DE_ACCESS)
+			return -EPERM;
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static long long dancy_syscall_reserved(va_list va)
 {
 	return (void)va, -EINVAL;
@@ -1401,6 +1527,8 @@ static struct { long long (*handler)(va_list va); } handler_array[] = {
 	{ dancy_syscall_procinfo },
 	{ dancy_syscall_errno },
 	{ dancy_syscall_arctic },
+	{ dancy_syscall_yield },
+	{ dancy_syscall_setaffinity },
 	{ dancy_syscall_reserved }
 };
 
@@ -1433,6 +1561,8 @@ long long syscall_handler(int arg0, ...)
 	va_list va;
 	va_start(va, arg0);
 
+	task_account_mode(0);
+
 	if (arg0 > __dancy_syscall_arg0__ && arg0 < __dancy_syscall_argn__) {
 		int i = arg0 - __dancy_syscall_arg0__ - 1;
 		r = handler_array[i].handler(va);
@@ -1440,5 +1570,7 @@ long long syscall_handler(int arg0, ...)
 
 	va_end(va);
 
+	task_account_mode(1);
+
 	return r;
 }
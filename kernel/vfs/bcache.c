@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2026 Antti Tiihala
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ * vfs/bcache.c
+ *      Block buffer cache
+ */
+
+#include <dancy.h>
+
+/*
+ * The cached blocks are identified by the device number and the logical
+ * block address. The blocks are in a hash table and in one LRU list, and
+ * the least recently used blocks are freed when the cache is full. The
+ * cache is write-through, so the blocks are never dirty.
+ */
+#define BCACHE_HASH (1024)
+#define BCACHE_MAX_BLOCK_SIZE (4096)
+
+struct bcache_block {
+	struct bcache_block *hash_next;
+	struct bcache_block *lru_prev;
+	struct bcache_block *lru_next;
+
+	uint64_t lba;
+	int device;
+};
+
+static mtx_t bcache_mtx;
+static int bcache_ready;
+
+static struct bcache_block *bcache_hash[BCACHE_HASH];
+static struct bcache_block *bcache_lru_head;
+static struct bcache_block *bcache_lru_tail;
+
+static size_t bcache_size;
+static size_t bcache_limit;
+
+static struct {
+	struct vfs_node *node;
+	size_t block_size;
+	struct bcache_stat stat;
+} bcache_devices[BCACHE_DEVICES];
+
+int bcache_init(void)
+{
+	static int run_once;
+	size_t allocated, unallocated, pages;
+
+	if (!spin_trylock(&run_once))
+		return DE_UNEXPECTED;
+
+	if (mtx_init(&bcache_mtx, mtx_plain) != thrd_success)
+		return DE_UNEXPECTED;
+
+	/*
+	 * The cache uses 1/32 of the available memory, but not more
+	 * than 1/4 of the unallocated heap memory.
+	 */
+	heap_usage(&allocated, &unallocated);
+
+#ifdef DANCY_32
+	pages = mm_available_pages(mm_addr32);
+#else
+	pages = mm_available_pages(mm_addr36);
+#endif
+	bcache_limit = (pages / 32) * 0x1000;
+
+	if (bcache_limit > unallocated / 4)
+		bcache_limit = unallocated / 4;
+
+	bcache_ready = 1;
+
+	return 0;
+}
+
+static void bcache_enter(void)
+{
+	if (mtx_lock(&bcache_mtx) != thrd_success)
+		kernel->panic("bcache: unexpected mutex error");
+}
+
+static void bcache_leave(void)
+{
+	mtx_unlock(&bcache_mtx);
+}
+
+static size_t bcache_key(int device, uint64_t lba)
+{
+	uint64_t key = lba ^ ((uint64_t)device << 24);
+
+	return (size_t)(key % BCACHE_HASH);
+}
+
+static unsigned char *bcache_data(struct bcache_block *b)
+{
+	return (unsigned char *)(b + 1);
+}
+
+static struct bcache_block *bcache_find(int device, uint64_t lba)
+{
+	struct bcache_block *b = bcache_hash[bcache_key(device, lba)];
+
+	while (b != NULL) {
+		if (b->lba == lba && b->device == device)
+			return b;
+		b = b->hash_next;
+	}
+
+	return NULL;
+}
+
+static void bcache_unlink(struct bcache_block *b)
+{
+	if (b->lru_prev != NULL)
+		b->lru_prev->lru_next = b->lru_next;
+	else
+		bcache_lru_head = b->lru_next;
+
+	if (b->lru_next != NULL)
+		b->lru_next->lru_prev = b->lru_prev;
+	else
+		bcache_lru_tail = b->lru_prev;
+}
+
+static void bcache_touch(struct bcache_block *b)
+{
+	if (bcache_lru_head == b)
+		return;
+
+	bcache_unlink(b);
+
+	b->lru_prev = NULL;
+	b->lru_next = bcache_lru_head;
+
+	if (bcache_lru_head != NULL)
+		bcache_lru_head->lru_prev = b;
+	else
+		bcache_lru_tail = b;
+
+	bcache_lru_head = b;
+}
+
+static void bcache_delete(struct bcache_block *b)
+{
+	struct bcache_block **link;
+	int device = b->device;
+
+	link = &bcache_hash[bcache_key(device, b->lba)];
+
+	while (*link != b)
+		link = &(*link)->hash_next;
+
+	*link = b->hash_next;
+	bcache_unlink(b);
+
+	bcache_size -= bcache_devices[device].block_size;
+	bcache_devices[device].stat.blocks -= 1;
+
+	free(b);
+}
+
+static void bcache_insert(int device, uint64_t lba, const void *data)
+{
+	size_t block_size = bcache_devices[device].block_size;
+	struct bcache_block *b;
+	size_t key;
+
+	if ((b = bcache_find(device, lba)) != NULL) {
+		memcpy(bcache_data(b), data, block_size);
+		bcache_touch(b);
+		return;
+	}
+
+	while (bcache_lru_tail != NULL) {
+		if (bcache_size + block_size <= bcache_limit)
+			break;
+		bcache_delete(bcache_lru_tail);
+	}
+
+	if (bcache_size + block_size > bcache_limit)
+		return;
+
+	if ((b = malloc(sizeof(*b) + block_size)) == NULL)
+		return;
+
+	key = bcache_key(device, lba);
+
+	b->hash_next = bcache_hash[key];
+	bcache_hash[key] = b;
+
+	b->lru_prev = NULL;
+	b->lru_next = bcache_lru_head;
+
+	if (bcache_lru_head != NULL)
+		bcache_lru_head->lru_prev = b;
+	else
+		bcache_lru_tail = b;
+
+	bcache_lru_head = b;
+
+	b->lba = lba;
+	b->device = device;
+
+	memcpy(bcache_data(b), data, block_size);
+
+	bcache_size += block_size;
+	bcache_devices[device].stat.blocks += 1;
+}
+
+static void bcache_invalidate_locked(int device)
+{
+	struct bcache_block *b = bcache_lru_head;
+
+	while (b != NULL) {
+		struct bcache_block *next = b->lru_next;
+
+		if (b->device == device)
+			bcache_delete(b);
+
+		b = next;
+	}
+}
+
+static int bcache_lock(int device, struct vfs_node *node,
+	size_t block_size, size_t size)
+{
+	if (!bcache_ready || device < 0 || device >= BCACHE_DEVICES)
+		return 1;
+
+	if (block_size == 0 || block_size > BCACHE_MAX_BLOCK_SIZE)
+		return 1;
+
+	if ((size % block_size) != 0)
+		return 1;
+
+	bcache_enter();
+
+	/*
+	 * The blocks are dropped if the device or its block size has
+	 * been changed.
+	 */
+	if (bcache_devices[device].node != node) {
+		bcache_invalidate_locked(device);
+		memset(&bcache_devices[device].stat, 0,
+			sizeof(bcache_devices[device].stat));
+		bcache_devices[device].node = node;
+		bcache_devices[device].block_size = block_size;
+	}
+
+	if (bcache_devices[device].block_size != block_size) {
+		bcache_invalidate_locked(device);
+		bcache_devices[device].block_size = block_size;
+	}
+
+	return 0;
+}
+
+int bcache_read(int device, struct vfs_node *node, size_t block_size,
+	uint64_t lba, size_t *size, void *buffer)
+{
+	unsigned char *p = buffer;
+	size_t count, i = 0, j;
+	int r;
+
+	if (bcache_lock(device, node, block_size, *size))
+		return node->n_read(node, lba * block_size, size, buffer);
+
+	count = *size / block_size;
+
+	while (i < count) {
+		struct bcache_block *b = bcache_find(device, lba + i);
+		size_t run_size;
+
+		if (b != NULL) {
+			memcpy(p + i * block_size, bcache_data(b), block_size);
+			bcache_touch(b);
+			bcache_devices[device].stat.hits += 1;
+			i += 1;
+			continue;
+		}
+
+		/*
+		 * Read the blocks that are not cached with one request.
+		 */
+		for (j = i + 1; j < count; j++) {
+			if (bcache_find(device, lba + j) != NULL)
+				break;
+		}
+
+		bcache_devices[device].stat.misses += (uint64_t)(j - i);
+		bcache_leave();
+
+		run_size = (j - i) * block_size;
+		r = node->n_read(node, (lba + i) * block_size,
+			&run_size, p + i * block_size);
+
+		if (r != 0 || run_size != (j - i) * block_size) {
+			*size = i * block_size + run_size;
+			return r;
+		}
+
+		bcache_enter();
+
+		if (bcache_devices[device].node == node) {
+			size_t k;
+
+			for (k = i; k < j; k++) {
+				const void *data = p + k * block_size;
+				bcache_insert(device, lba + k, data);
+			}
+		}
+
+		i = j;
+	}
+
+	bcache_leave();
+
+	return 0;
+}
+
+int bcache_write(int device, struct vfs_node *node, size_t block_size,
+	uint64_t lba, size_t *size, const void *buffer)
+{
+	size_t requested_size = *size;
+	const unsigned char *p = buffer;
+	size_t count, i;
+	int r;
+
+	r = node->n_write(node, lba * block_size, size, buffer);
+
+	if (bcache_lock(device, node, block_size, requested_size))
+		return r;
+
+	count = requested_size / block_size;
+
+	/*
+	 * The written blocks are cached. If the request failed, the
+	 * blocks are dropped because their state is not known.
+	 */
+	for (i = 0; i < count; i++) {
+		struct bcache_block *b;
+
+		if (r == 0 && *size == requested_size) {
+			bcache_insert(device, lba + i, p + i * block_size);
+			continue;
+		}
+
+		if ((b = bcache_find(device, lba + i)) != NULL)
+			bcache_delete(b);
+	}
+
+	bcache_leave();
+
+	return r;
+}
+
+void bcache_invalidate(int device)
+{
+	if (!bcache_ready || device < 0 || device >= BCACHE_DEVICES)
+		return;
+
+	bcache_enter();
+	bcache_invalidate_locked(device);
+	bcache_leave();
+}
+
+int bcache_stat(int device, struct bcache_stat *stat)
+{
+	int r = DE_ARGUMENT;
+
+	memset(stat, 0, sizeof(*stat));
+
+	if (!bcache_ready || device < 0 || device >= BCACHE_DEVICES)
+		return r;
+
+	bcache_enter();
+
+	if (bcache_devices[device].node != NULL) {
+		memcpy(stat, &bcache_devices[device].stat, sizeof(*stat));
+		stat->block_size = bcache_devices[device].block_size;
+		r = 0;
+	}
+
+	bcache_leave();
+
+	return r;
+}
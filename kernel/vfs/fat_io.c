@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022, 2023 Antti Tiihala
+ * Copyright (c) 2022, 2023, 2026 Antti Tiihala
  *
  * Permission to use, copy, modify, and/or distribute this software for any
  * purpose with or without fee is hereby granted, provided that the above
@@ -20,6 +20,7 @@
 #include <dancy.h>
 
 #define FAT_IO_TOTAL 64
+#define FAT_IO_DIR_RECORDS 64
 
 struct fat_io {
 	struct vfs_node *dev_node;
@@ -41,6 +42,10 @@ struct fat_internal_data {
 	struct fat_io *io;
 	int fd;
 	int media_changed;
+
+	unsigned char *dir_buffer;
+	uint32_t dir_offset;
+	uint32_t dir_count;
 };
 
 static void check_id(int id)
@@ -160,6 +165,8 @@ static dancy_time_t calculate_time(int fat_date, int fat_time)
 	return (dancy_time_t)r;
 }
 
+static void leave_fat(struct vfs_node *node);
+
 static int enter_fat(struct vfs_node *node)
 {
 	struct fat_internal_data *data = node->internal_data;
@@ -169,12 +176,29 @@ static int enter_fat(struct vfs_node *node)
 	if (mtx_lock(&io->fat_mtx) != thrd_success)
 		kernel->panic("fat_io: unexpected mutex error");
 
+	/*
+	 * Check the media before every request. The cached blocks
+	 * do not access the device, so the media change would not be
+	 * noticed otherwise.
+	 */
+	if (!io->media_changed) {
+		r = io->dev_node->n_sync(io->dev_node);
+
+		if (r == DE_MEDIA_CHANGED) {
+			io->media_changed = 1;
+			leave_fat(node);
+			return DE_MEDIA_CHANGED;
+		}
+	}
+
 	if (io->media_changed) {
 		int fd = INT_MIN;
 
 		if (io->instance)
 			fat_delete(io->instance), io->instance = NULL;
 
+		bcache_invalidate(io->id);
+		vfs_dentry_invalidate();
 		io->media_changed = 0;
 
 		if (fat_create(&io->instance, io->id)) {
@@ -281,6 +305,7 @@ static void n_release(struct vfs_node **node)
 			io->node_array[fd] = NULL;
 		}
 
+		free(data->dir_buffer);
 		free_fat_io = 1;
 
 		for (i = 0; i < io->node_count; i++) {
@@ -382,6 +407,13 @@ static int n_open(struct vfs_node *node, const char *name,
 	if ((r = enter_fat(node)) != 0)
 		return r;
 
+	/*
+	 * The buffered directory records can not be used if a new
+	 * record may be created.
+	 */
+	if ((mode & vfs_mode_create) != 0)
+		data->dir_count = 0;
+
 	if ((allocated_node = alloc_node(io)) == NULL)
 		return leave_fat(node), DE_MEMORY;
 
@@ -614,12 +646,70 @@ static int n_sync(struct vfs_node *node)
 	return r;
 }
 
+static int read_dir_record(struct vfs_node *node,
+	uint32_t record_offset, unsigned char *record)
+{
+	void *instance;
+	struct fat_internal_data *data = node->internal_data;
+	size_t read_size = FAT_IO_DIR_RECORDS * 32;
+	uint32_t i = record_offset - data->dir_offset;
+	int r;
+
+	/*
+	 * The records are read in batches. A zero record is returned
+	 * if the offset is after the last record of the directory.
+	 */
+	if (data->dir_count != 0 && !data->media_changed) {
+		if (record_offset >= data->dir_offset && i < data->dir_count) {
+			memcpy(record, &data->dir_buffer[i * 32], 32);
+			return 0;
+		}
+
+		if (record_offset >= data->dir_offset) {
+			if (data->dir_count < FAT_IO_DIR_RECORDS) {
+				memset(record, 0, 32);
+				return 0;
+			}
+		}
+	}
+
+	data->dir_count = 0;
+
+	if (data->dir_buffer == NULL) {
+		data->dir_buffer = malloc(FAT_IO_DIR_RECORDS * 32);
+
+		if (data->dir_buffer == NULL)
+			return DE_MEMORY;
+	}
+
+	instance = data->io->instance;
+	r = fat_seek(instance, data->fd, (int)record_offset * 32, 0);
+
+	if (!r)
+		r = fat_read(instance, data->fd, &read_size, data->dir_buffer);
+
+	if (r)
+		return translate_error(r);
+
+	data->dir_offset = record_offset;
+	data->dir_count = (uint32_t)(read_size / 32);
+
+	if (data->dir_count == 0) {
+		memset(record, 0, 32);
+		return 0;
+	}
+
+	memcpy(record, &data->dir_buffer[0], 32);
+
+	return 0;
+}
+
 static int n_readdir(struct vfs_node *node,
 	uint32_t offset, struct vfs_dent *dent)
 {
-	void *instance;
 	struct fat_internal_data *data = node->internal_data;
-	int read_offset;
+	unsigned char fat_record[32];
+	uint32_t record_offset;
 	int i, r;
 
 	memset(dent, 0, sizeof(*dent));
@@ -647,90 +737,81 @@ static int n_readdir(struct vfs_node *node,
 			return r;
 	}
 
-	r = data->io->dev_node->n_sync(data->io->dev_node);
-
-	if (r == DE_MEDIA_CHANGED) {
-		data->io->media_changed = 1;
-		return leave_fat(node), DE_MEDIA_CHANGED;
-	}
-
 	if (!strcmp(&data->path[0], "/."))
-		read_offset = (int)(offset - 2) * 32;
+		record_offset = offset - 2;
 	else
-		read_offset = (int)offset * 32;
+		record_offset = offset;
 
-	instance = data->io->instance;
-	r = fat_seek(instance, data->fd, read_offset, 0);
+	/*
+	 * Start a new batch of records if the first record is read.
+	 */
+	if (offset == 2)
+		data->dir_count = 0;
+
+	r = read_dir_record(node, record_offset, &fat_record[0]);
 
 	if (!r) {
-		unsigned char fat_record[32];
-		size_t read_size = 32;
+		char *name = &dent->name[0];
+		int base_size = 8;
+		int ext_size = 3;
 		int fat_attributes;
 
-		r = fat_read(instance, data->fd, &read_size, &fat_record[0]);
-
-		if (!r) {
-			char *name = &dent->name[0];
-			int base_size = 8;
-			int ext_size = 3;
-
-			if (read_size != 32 || fat_record[0] == 0)
-				return leave_fat(node), 0;
-
-			if (fat_record[0] == 0x60)
-				fat_record[0] = 0x2E;
+		if (fat_record[0] == 0)
+			return leave_fat(node), 0;
 
-			fat_attributes = (int)fat_record[11];
+		if (fat_record[0] == 0x60)
+			fat_record[0] = 0x2E;
 
-			if (fat_record[0] == 0xE5)
-				return leave_fat(node), DE_PLACEHOLDER;
+		fat_attributes = (int)fat_record[11];
 
-			if ((fat_attributes & 0x08) != 0)
-				return leave_fat(node), DE_PLACEHOLDER;
+		if (fat_record[0] == 0xE5)
+			return leave_fat(node), DE_PLACEHOLDER;
 
-			for (i = 0; i < 11; i++) {
-				int c = (int)fat_record[i];
+		if ((fat_attributes & 0x08) != 0)
+			return leave_fat(node), DE_PLACEHOLDER;
 
-				if (c == '\0') {
-					leave_fat(node);
-					return DE_UNEXPECTED;
-				}
+		for (i = 0; i < 11; i++) {
+			int c = (int)fat_record[i];
 
-				if (c >= 'A' && c <= 'Z') {
-					int lower = c + 32;
-					fat_record[i] = (unsigned char)lower;
-				}
+			if (c == '\0') {
+				leave_fat(node);
+				return DE_UNEXPECTED;
 			}
 
-			for (i = 7; i >= 0; i--) {
-				if (fat_record[i] != 0x20)
-					break;
-				base_size -= 1;
+			if (c >= 'A' && c <= 'Z') {
+				int lower = c + 32;
+				fat_record[i] = (unsigned char)lower;
 			}
+		}
 
-			if (base_size == 0)
-				return leave_fat(node), DE_PLACEHOLDER;
+		for (i = 7; i >= 0; i--) {
+			if (fat_record[i] != 0x20)
+				break;
+			base_size -= 1;
+		}
 
-			for (i = 10; i >= 8; i--) {
-				if (fat_record[i] != 0x20)
-					break;
-				ext_size -= 1;
-			}
+		if (base_size == 0)
+			return leave_fat(node), DE_PLACEHOLDER;
 
-			for (i = 0; i < base_size; i++)
-				*name++ = (char)fat_record[i];
+		for (i = 10; i >= 8; i--) {
+			if (fat_record[i] != 0x20)
+				break;
+			ext_size -= 1;
+		}
 
-			if (ext_size != 0)
-				*name++ = '.';
+		for (i = 0; i < base_size; i++)
+			*name++ = (char)fat_record[i];
 
-			for (i = 8; i < ext_size + 8; i++)
-				*name++ = (char)fat_record[i];
-		}
+		if (ext_size != 0)
+			*name++ = '.';
+
+		for (i = 8; i < ext_size + 8; i++)
+			*name++ = (char)fat_record[i];
 	}
 
 	leave_fat(node);
 
-	return (r != 0) ? translate_error(r) : 0;
+	return r;
 }
 
 static int n_stat(struct vfs_node *node, struct vfs_stat *stat)
@@ -871,6 +952,7 @@ static int n_remove(struct vfs_node *node, const char *name, int dir)
 		return r;
 
 	instance = data->io->instance;
+	data->dir_count = 0;
 
 	if (dir)
 		buf[size - 1] = '/';
@@ -902,6 +984,7 @@ static struct vfs_node *alloc_node(struct fat_io *io)
 
 		node->count = 1;
 		node->internal_data = (void *)a;
+		node->dentry_negative = 1;
 
 		node->n_release  = n_release;
 		node->n_open     = n_open;
@@ -1055,11 +1138,17 @@ int fat_io_read(int id, size_t lba, size_t *size, void *buf)
 	if (node->n_stat(node, &stat))
 		return 1;
 
-	if (stat.block_size == 0)
-		stat.block_size = 512;
-
-	offset = (uint64_t)lba * (uint64_t)stat.block_size;
-	r = node->n_read(node, offset, size, buf);
+	/*
+	 * The memory-backed devices do not have a block size, and they
+	 * are not cached.
+	 */
+	if (stat.block_size != 0) {
+		r = bcache_read(io->id, node, stat.block_size,
+			(uint64_t)lba, size, buf);
+	} else {
+		offset = (uint64_t)lba * 512;
+		r = node->n_read(node, offset, size, buf);
+	}
 
 	if (r == DE_MEDIA_CHANGED)
 		io->media_changed = 1;
@@ -1090,11 +1179,13 @@ int fat_io_write(int id, size_t lba, size_t *size, const void *buf)
 	if (node->n_stat(node, &stat))
 		return 1;
 
-	if (stat.block_size == 0)
-		stat.block_size = 512;
-
-	offset = (uint64_t)lba * (uint64_t)stat.block_size;
-	r = node->n_write(node, offset, size, buf);
+	if (stat.block_size != 0) {
+		r = bcache_write(io->id, node, stat.block_size,
+			(uint64_t)lba, size, buf);
+	} else {
+		offset = (uint64_t)lba * 512;
+		r = node->n_write(node, offset, size, buf);
+	}
 
 	if (r == DE_MEDIA_CHANGED)
 		io->media_changed = 1;
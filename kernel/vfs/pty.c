@@ -848,8 +848,9 @@ static int n_ioctl(struct vfs_node *node,
 	if (request == __DANCY_IOCTL_TIOCSPGRP) {
 		const __dancy_pid_t *s = (const void *)((addr_t)arg);
 		__dancy_pid_t group[2] = { *s, -1 };
+		uint64_t id_group = (uint64_t)group[0];
 
-		task_foreach(func_tiocspgrp, &group[0]);
+		task_foreach_group(id_group, func_tiocspgrp, &group[0]);
 
 		if (group[1] < 0)
 			return DE_ACCESS;
@@ -28,6 +28,25 @@ static void n_release_panic(struct vfs_node **node);
 #define VFS_PATH_COUNT  32
 #define VFS_PATH_BUFFER 1024
 
+/*
+ * The nodes of the tree are in a hash table, which is keyed by the
+ * owner node and the name. The names that were not found are kept in
+ * a separate table if the owner allows it (dentry_negative), and the
+ * table is invalidated by incrementing the generation number.
+ */
+#define VFS_DENTRY_HASH 256
+#define VFS_DENTRY_NAME 48
+
+static struct vfs_node *dentry_hash[VFS_DENTRY_HASH];
+
+static struct {
+	const struct vfs_node *owner;
+	uint32_t generation;
+	char name[VFS_DENTRY_NAME];
+} negative_dentries[VFS_DENTRY_HASH];
+
+static uint32_t dentry_generation = 1;
+
 static struct {
 	char *components[VFS_PATH_COUNT];
 	int type;
@@ -139,6 +158,9 @@ int vfs_init(void)
 	if (mtx_init(&tree_mtx, mtx_plain) != thrd_success)
 		return DE_UNEXPECTED;
 
+	if ((r = bcache_init()) != 0)
+		return r;
+
 	if ((r = vfs_init_root(&root_node)) != 0)
 		return r;
 
@@ -179,6 +201,90 @@ void vfs_unlock_tree(void)
 	mtx_unlock(&tree_mtx);
 }
 
+static unsigned int dentry_key(const struct vfs_node *owner, const char *name)
+{
+	unsigned int key = (unsigned int)((addr_t)owner >> 4);
+
+	while (*name != '\0')
+		key = key * 31 + (unsigned int)((unsigned char)*name++);
+
+	return key % VFS_DENTRY_HASH;
+}
+
+static void dentry_insert(struct vfs_node *node)
+{
+	unsigned int key = dentry_key(node->tree[0], &node->name[0]);
+
+	node->dentry_next = dentry_hash[key];
+	dentry_hash[key] = node;
+}
+
+static void dentry_delete_owner(const struct vfs_node *owner)
+{
+	int i;
+
+	for (i = 0; i < VFS_DENTRY_HASH; i++) {
+		if (negative_dentries[i].owner == owner)
+			negative_dentries[i].owner = NULL;
+	}
+}
+
+static void dentry_remove(struct vfs_node *node)
+{
+	unsigned int key = dentry_key(node->tree[0], &node->name[0]);
+	struct vfs_node **link = &dentry_hash[key];
+
+	while (*link != node) {
+		if (*link == NULL)
+			kernel->panic(unexpected_tree_error);
+		link = &(*link)->dentry_next;
+	}
+
+	*link = node->dentry_next;
+	node->dentry_next = NULL;
+
+	/*
+	 * The negative entries of the node can not be used anymore
+	 * because the address may be reused by another node.
+	 */
+	dentry_delete_owner(node);
+}
+
+static int dentry_find_negative(const struct vfs_node *owner, const char *name)
+{
+	unsigned int key = dentry_key(owner, name);
+	uint32_t generation = cpu_read32(&dentry_generation);
+
+	if (negative_dentries[key].owner != owner)
+		return 0;
+
+	if (negative_dentries[key].generation != generation)
+		return 0;
+
+	return !strcmp(&negative_dentries[key].name[0], name);
+}
+
+static void dentry_add_negative(const struct vfs_node *owner, const char *name)
+{
+	unsigned int key = dentry_key(owner, name);
+
+	if (!owner->dentry_negative || strlen(name) >= VFS_DENTRY_NAME)
+		return;
+
+	negative_dentries[key].owner = owner;
+	negative_dentries[key].generation = cpu_read32(&dentry_generation);
+	strcpy(&negative_dentries[key].name[0], name);
+}
+
+void vfs_dentry_invalidate(void)
+{
+	/*
+	 * This function does not need the tree lock, so it can be called
+	 * by the file system drivers, e.g. when the media has changed.
+	 */
+	cpu_add32(&dentry_generation, 1);
+}
+
 static void add_node(struct vfs_node *owner, struct vfs_node *node)
 {
 	if (owner == node)
@@ -189,6 +295,7 @@ static void add_node(struct vfs_node *owner, struct vfs_node *node)
 	node->tree[2] = NULL;
 
 	owner->tree[2] = node;
+	dentry_insert(node);
 }
 
 static void remove_leaf_node(struct vfs_node *node)
@@ -213,18 +320,20 @@ static void remove_leaf_node(struct vfs_node *node)
 		owner->tree[2] = p2->tree[1];
 	else
 		p1->tree[1] = p2->tree[1];
+
+	dentry_remove(node);
 }
 
 static struct vfs_node *find_node(struct vfs_node *owner, const char *name)
 {
-	struct vfs_node *p = owner->tree[2];
+	struct vfs_node *p = dentry_hash[dentry_key(owner, name)];
 	int i = 0;
 
 	while (p != NULL) {
-		if (!strcmp(&p->name[0], name))
+		if (p->tree[0] == owner && !strcmp(&p->name[0], name))
 			return p;
 
-		p = p->tree[1];
+		p = p->dentry_next;
 
 		if (++i == INT_MAX)
 			kernel->panic(unexpected_tree_error);
@@ -456,6 +565,9 @@ int vfs_mount(const char *name, struct vfs_node *node)
 			p1->tree[1] = node;
 	}
 
+	dentry_remove(target_node);
+	dentry_insert(node);
+
 	target_node->tree[0] = NULL;
 	target_node->tree[1] = NULL;
 
@@ -556,14 +668,33 @@ int vfs_open(const char *name, struct vfs_node **node, int type, int mode)
 			continue;
 		}
 
+		/*
+		 * The negative entries are not used if the node could be
+		 * created. All entries of the owner are deleted because
+		 * the file system may not compare the names exactly, e.g.
+		 * the names are not case-sensitive.
+		 */
+		if (last_component && (mode & vfs_mode_create) != 0) {
+			dentry_delete_owner(owner);
+		} else if (dentry_find_negative(owner, n)) {
+			r = DE_NAME;
+			break;
+		}
+
 		if (last_component) {
 			r = owner->n_open(owner, n, &new_node, type, mode);
 
+			if (r == DE_NAME && (mode & vfs_mode_create) == 0)
+				dentry_add_negative(owner, n);
+
 			if (r != 0)
 				break;
 		} else {
 			r = owner->n_open(owner, n, &new_node, 0, 0);
 
+			if (r == DE_NAME)
+				dentry_add_negative(owner, n);
+
 			if (r != 0)
 				break;
 		}
@@ -749,5 +880,10 @@ int vfs_rename(const char *old_name, const char *new_name)
 	(void)old_name;
 	(void)new_name;
 
+	/*
+	 * If renaming is supported, the negative entries of the new
+	 * name must be invalidated (vfs_dentry_invalidate).
+	 */
+
 	return DE_UNSUPPORTED;
 }
@@ -4,6 +4,7 @@
 
 ARCTIC_BIN32_FILES= \
  ./arctic/bin32/hello \
+ ./arctic/bin32/bench \
  ./arctic/bin32/cat \
  ./arctic/bin32/cp \
  ./arctic/bin32/date \
@@ -36,6 +37,7 @@ ARCTIC_BIN32_FILES= \
 ./arctic/bin32.img: $(ARCTIC_BIN32_FILES)
 	$(DY_VBR) -t ramfs $@ 2880
 	$(DY_MCOPY) -i $@ ./arctic/bin32/hello ::hello
+	$(DY_MCOPY) -i $@ ./arctic/bin32/bench ::bench
 	$(DY_MCOPY) -i $@ ./arctic/bin32/cat ::cat
 	$(DY_MCOPY) -i $@ ./arctic/bin32/cp ::cp
 	$(DY_MCOPY) -i $@ ./arctic/bin32/date ::date
@@ -4,6 +4,7 @@
 
 ARCTIC_BIN64_FILES= \
  ./arctic/bin64/hello \
+ ./arctic/bin64/bench \
  ./arctic/bin64/cat \
  ./arctic/bin64/cp \
  ./arctic/bin64/date \
@@ -36,6 +37,7 @@ ARCTIC_BIN64_FILES= \
 ./arctic/bin64.img: $(ARCTIC_BIN64_FILES)
 	$(DY_VBR) -t ramfs $@ 2880
 	$(DY_MCOPY) -i $@ ./arctic/bin64/hello ::hello
+	$(DY_MCOPY) -i $@ ./arctic/bin64/bench ::bench
 	$(DY_MCOPY) -i $@ ./arctic/bin64/cat ::cat
 	$(DY_MCOPY) -i $@ ./arctic/bin64/cp ::cp
 	$(DY_MCOPY) -i $@ ./arctic/bin64/date ::date
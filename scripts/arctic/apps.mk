@@ -2,6 +2,26 @@
 
 ##############################################################################
 
+ARCTIC_APPS_BENCH_OBJECTS_32= \
+ ./o32/arctic/apps/bench/jitter.o \
+ ./o32/arctic/apps/bench/main.o \
+ ./o32/arctic/apps/bench/mmap.o \
+ ./o32/arctic/apps/bench/operate.o \
+ ./o32/arctic/apps/bench/pingpong.o \
+ ./o32/arctic/apps/bench/syscall.o \
+ ./o32/arctic/apps/bench/yield.o \
+ ./o32/arctic/libc.a \
+
+ARCTIC_APPS_BENCH_OBJECTS_64= \
+ ./o64/arctic/apps/bench/jitter.o \
+ ./o64/arctic/apps/bench/main.o \
+ ./o64/arctic/apps/bench/mmap.o \
+ ./o64/arctic/apps/bench/operate.o \
+ ./o64/arctic/apps/bench/pingpong.o \
+ ./o64/arctic/apps/bench/syscall.o \
+ ./o64/arctic/apps/bench/yield.o \
+ ./o64/arctic/libc.a \
+
 ARCTIC_APPS_HELLO_OBJECTS_32= \
  ./o32/arctic/apps/hello/main.o \
  ./o32/arctic/apps/hello/operate.o \
@@ -14,11 +34,20 @@ ARCTIC_APPS_HELLO_OBJECTS_64= \
 
 ##############################################################################
 
+ARCTIC_APPS_BENCH_HEADERS= \
+ ./arctic/apps/bench/main.h \
+
 ARCTIC_APPS_HELLO_HEADERS= \
  ./arctic/apps/hello/main.h \
 
 ##############################################################################
 
+./arctic/bin32/bench: $(ARCTIC_APPS_BENCH_OBJECTS_32)
+	$(DY_LINK) -o$@ $(ARCTIC_APPS_BENCH_OBJECTS_32)
+
+./arctic/bin64/bench: $(ARCTIC_APPS_BENCH_OBJECTS_64)
+	$(DY_LINK) -o$@ $(ARCTIC_APPS_BENCH_OBJECTS_64)
+
 ./arctic/bin32/hello: $(ARCTIC_APPS_HELLO_OBJECTS_32)
 	$(DY_LINK) -o$@ $(ARCTIC_APPS_HELLO_OBJECTS_32)
 
@@ -64,6 +64,7 @@ ARCTIC_LIBC_OBJECTS_32= \
  ./o32/arctic/libc/misc/memusage.o \
  ./o32/arctic/libc/misc/procinfo.o \
  ./o32/arctic/libc/misc/proclist.o \
+ ./o32/arctic/libc/misc/setaffinity.o \
  ./o32/arctic/libc/poll/poll.o \
  ./o32/arctic/libc/poll/ppoll.o \
  ./o32/arctic/libc/pty/openpty.o \
@@ -71,6 +72,7 @@ ARCTIC_LIBC_OBJECTS_32= \
  ./o32/arctic/libc/regex/regerror.o \
  ./o32/arctic/libc/regex/regexec.o \
  ./o32/arctic/libc/regex/regfree.o \
+ ./o32/arctic/libc/sched/yield.o \
  ./o32/arctic/libc/signal/action.o \
  ./o32/arctic/libc/signal/kill.o \
  ./o32/arctic/libc/signal/pending.o \
@@ -82,6 +84,7 @@ ARCTIC_LIBC_OBJECTS_32= \
  ./o32/arctic/libc/spawn/addclose.o \
  ./o32/arctic/libc/spawn/adddup2.o \
  ./o32/arctic/libc/spawn/addopen.o \
+ ./o32/arctic/libc/spawn/affinity.o \
  ./o32/arctic/libc/spawn/attr.o \
  ./o32/arctic/libc/spawn/flags.o \
  ./o32/arctic/libc/spawn/pgroup.o \
@@ -200,6 +203,7 @@ ARCTIC_LIBC_OBJECTS_32= \
  ./o32/arctic/libc/sys/munmap.o \
  ./o32/arctic/libc/sys/select.o \
  ./o32/arctic/libc/sys/stat.o \
+ ./o32/arctic/libc/sys/times.o \
  ./o32/arctic/libc/sys/umask.o \
  ./o32/arctic/libc/sys/wait.o \
  ./o32/arctic/libc/sys/waitpid.o \
@@ -331,6 +335,7 @@ ARCTIC_LIBC_OBJECTS_64= \
  ./o64/arctic/libc/misc/memusage.o \
  ./o64/arctic/libc/misc/procinfo.o \
  ./o64/arctic/libc/misc/proclist.o \
+ ./o64/arctic/libc/misc/setaffinity.o \
  ./o64/arctic/libc/poll/poll.o \
  ./o64/arctic/libc/poll/ppoll.o \
  ./o64/arctic/libc/pty/openpty.o \
@@ -338,6 +343,7 @@ ARCTIC_LIBC_OBJECTS_64= \
  ./o64/arctic/libc/regex/regerror.o \
  ./o64/arctic/libc/regex/regexec.o \
  ./o64/arctic/libc/regex/regfree.o \
+ ./o64/arctic/libc/sched/yield.o \
  ./o64/arctic/libc/signal/action.o \
  ./o64/arctic/libc/signal/kill.o \
  ./o64/arctic/libc/signal/pending.o \
@@ -349,6 +355,7 @@ ARCTIC_LIBC_OBJECTS_64= \
  ./o64/arctic/libc/spawn/addclose.o \
  ./o64/arctic/libc/spawn/adddup2.o \
  ./o64/arctic/libc/spawn/addopen.o \
+ ./o64/arctic/libc/spawn/affinity.o \
  ./o64/arctic/libc/spawn/attr.o \
  ./o64/arctic/libc/spawn/flags.o \
  ./o64/arctic/libc/spawn/pgroup.o \
@@ -467,6 +474,7 @@ ARCTIC_LIBC_OBJECTS_64= \
  ./o64/arctic/libc/sys/munmap.o \
  ./o64/arctic/libc/sys/select.o \
  ./o64/arctic/libc/sys/stat.o \
+ ./o64/arctic/libc/sys/times.o \
  ./o64/arctic/libc/sys/umask.o \
  ./o64/arctic/libc/sys/wait.o \
  ./o64/arctic/libc/sys/waitpid.o \
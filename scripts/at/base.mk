@@ -23,11 +23,14 @@ DANCY_BASE_OBJECTS_32= \
  ./o32/kernel/base/mtx.o \
  ./o32/kernel/base/panic.o \
  ./o32/kernel/base/pg.o \
+ ./o32/kernel/base/pg_file.o \
  ./o32/kernel/base/ret_user.o \
  ./o32/kernel/base/runlevel.o \
  ./o32/kernel/base/spin.o \
  ./o32/kernel/base/start.o \
  ./o32/kernel/base/task.o \
+ ./o32/kernel/base/timer.o \
+ ./o32/kernel/base/waitq.o \
 
 DANCY_BASE_OBJECTS_64= \
  ./o64/kernel/base/a64/fb.o \
@@ -50,11 +53,14 @@ DANCY_BASE_OBJECTS_64= \
  ./o64/kernel/base/mtx.o \
  ./o64/kernel/base/panic.o \
  ./o64/kernel/base/pg.o \
+ ./o64/kernel/base/pg_file.o \
  ./o64/kernel/base/ret_user.o \
  ./o64/kernel/base/runlevel.o \
  ./o64/kernel/base/spin.o \
  ./o64/kernel/base/start.o \
  ./o64/kernel/base/task.o \
+ ./o64/kernel/base/timer.o \
+ ./o64/kernel/base/waitq.o \
 
 ##############################################################################
 
@@ -4,6 +4,7 @@
 
 DANCY_VFS_OBJECTS_32= \
  ./o32/common/fat.o \
+ ./o32/kernel/vfs/bcache.o \
  ./o32/kernel/vfs/default.o \
  ./o32/kernel/vfs/devfs.o \
  ./o32/kernel/vfs/fat_io.o \
@@ -14,6 +15,7 @@ DANCY_VFS_OBJECTS_32= \
 
 DANCY_VFS_OBJECTS_64= \
  ./o64/common/fat.o \
+ ./o64/kernel/vfs/bcache.o \
  ./o64/kernel/vfs/default.o \
  ./o64/kernel/vfs/devfs.o \
  ./o64/kernel/vfs/fat_io.o \
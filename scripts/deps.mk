@@ -43,6 +43,7 @@ DANCY_HEADERS= \
  ./arctic/include/pty.h \
  ./arctic/include/pwd.h \
  ./arctic/include/regex.h \
+ ./arctic/include/sched.h \
  ./arctic/include/setjmp.h \
  ./arctic/include/signal.h \
  ./arctic/include/spawn.h \
@@ -56,6 +57,7 @@ DANCY_HEADERS= \
  ./arctic/include/sys/select.h \
  ./arctic/include/sys/stat.h \
  ./arctic/include/sys/time.h \
+ ./arctic/include/sys/times.h \
  ./arctic/include/sys/types.h \
  ./arctic/include/sys/wait.h \
  ./arctic/include/termios.h \
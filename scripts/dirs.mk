@@ -11,6 +11,7 @@
 	@mkdir "o32"
 	@mkdir "o32/arctic"
 	@mkdir "o32/arctic/apps"
+	@mkdir "o32/arctic/apps/bench"
 	@mkdir "o32/arctic/apps/hello"
 	@mkdir "o32/arctic/libc"
 	@mkdir "o32/arctic/libc/a32"
@@ -27,6 +28,7 @@
 	@mkdir "o32/arctic/libc/poll"
 	@mkdir "o32/arctic/libc/pty"
 	@mkdir "o32/arctic/libc/regex"
+	@mkdir "o32/arctic/libc/sched"
 	@mkdir "o32/arctic/libc/signal"
 	@mkdir "o32/arctic/libc/spawn"
 	@mkdir "o32/arctic/libc/stdio"
@@ -96,6 +98,7 @@
 	@mkdir "o64"
 	@mkdir "o64/arctic"
 	@mkdir "o64/arctic/apps"
+	@mkdir "o64/arctic/apps/bench"
 	@mkdir "o64/arctic/apps/hello"
 	@mkdir "o64/arctic/libc"
 	@mkdir "o64/arctic/libc/a64"
@@ -112,6 +115,7 @@
 	@mkdir "o64/arctic/libc/poll"
 	@mkdir "o64/arctic/libc/pty"
 	@mkdir "o64/arctic/libc/regex"
+	@mkdir "o64/arctic/libc/sched"
 	@mkdir "o64/arctic/libc/signal"
 	@mkdir "o64/arctic/libc/spawn"
 	@mkdir "o64/arctic/libc/stdio"
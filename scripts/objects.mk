@@ -2,6 +2,41 @@
 
 ##############################################################################
 
+./o32/arctic/apps/bench/jitter.o: \
+    ./arctic/apps/bench/jitter.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O32)$@ ./arctic/apps/bench/jitter.c
+
+./o32/arctic/apps/bench/main.o: \
+    ./arctic/apps/bench/main.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O32)$@ ./arctic/apps/bench/main.c
+
+./o32/arctic/apps/bench/mmap.o: \
+    ./arctic/apps/bench/mmap.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O32)$@ ./arctic/apps/bench/mmap.c
+
+./o32/arctic/apps/bench/operate.o: \
+    ./arctic/apps/bench/operate.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O32)$@ ./arctic/apps/bench/operate.c
+
+./o32/arctic/apps/bench/pingpong.o: \
+    ./arctic/apps/bench/pingpong.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O32)$@ ./arctic/apps/bench/pingpong.c
+
+./o32/arctic/apps/bench/syscall.o: \
+    ./arctic/apps/bench/syscall.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O32)$@ ./arctic/apps/bench/syscall.c
+
+./o32/arctic/apps/bench/yield.o: \
+    ./arctic/apps/bench/yield.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O32)$@ ./arctic/apps/bench/yield.c
+
 ./o32/arctic/apps/hello/main.o: \
     ./arctic/apps/hello/main.c $(DANCY_DEPS) \
     $(ARCTIC_APPS_HELLO_HEADERS)
@@ -256,6 +291,10 @@
     ./arctic/libc/misc/proclist.c $(DANCY_DEPS)
 	$(ARCTIC_O32)$@ ./arctic/libc/misc/proclist.c
 
+./o32/arctic/libc/misc/setaffinity.o: \
+    ./arctic/libc/misc/setaffinity.c $(DANCY_DEPS)
+	$(ARCTIC_O32)$@ ./arctic/libc/misc/setaffinity.c
+
 ./o32/arctic/libc/poll/poll.o: \
     ./arctic/libc/poll/poll.c $(DANCY_DEPS)
 	$(ARCTIC_O32)$@ ./arctic/libc/poll/poll.c
@@ -284,6 +323,10 @@
     ./arctic/libc/regex/regfree.c $(DANCY_DEPS)
 	$(ARCTIC_O32)$@ ./arctic/libc/regex/regfree.c
 
+./o32/arctic/libc/sched/yield.o: \
+    ./arctic/libc/sched/yield.c $(DANCY_DEPS)
+	$(ARCTIC_O32)$@ ./arctic/libc/sched/yield.c
+
 ./o32/arctic/libc/signal/action.o: \
     ./arctic/libc/signal/action.c $(DANCY_DEPS)
 	$(ARCTIC_O32)$@ ./arctic/libc/signal/action.c
@@ -328,6 +371,10 @@
     ./arctic/libc/spawn/addopen.c $(DANCY_DEPS)
 	$(ARCTIC_O32)$@ ./arctic/libc/spawn/addopen.c
 
+./o32/arctic/libc/spawn/affinity.o: \
+    ./arctic/libc/spawn/affinity.c $(DANCY_DEPS)
+	$(ARCTIC_O32)$@ ./arctic/libc/spawn/affinity.c
+
 ./o32/arctic/libc/spawn/attr.o: \
     ./arctic/libc/spawn/attr.c $(DANCY_DEPS)
 	$(ARCTIC_O32)$@ ./arctic/libc/spawn/attr.c
@@ -800,6 +847,10 @@
     ./arctic/libc/sys/stat.c $(DANCY_DEPS)
 	$(ARCTIC_O32)$@ ./arctic/libc/sys/stat.c
 
+./o32/arctic/libc/sys/times.o: \
+    ./arctic/libc/sys/times.c $(DANCY_DEPS)
+	$(ARCTIC_O32)$@ ./arctic/libc/sys/times.c
+
 ./o32/arctic/libc/sys/umask.o: \
     ./arctic/libc/sys/umask.c $(DANCY_DEPS)
 	$(ARCTIC_O32)$@ ./arctic/libc/sys/umask.c
@@ -1625,6 +1676,10 @@
     ./kernel/base/pg.c $(DANCY_DEPS)
 	$(DANCY_O32)$@ ./kernel/base/pg.c
 
+./o32/kernel/base/pg_file.o: \
+    ./kernel/base/pg_file.c $(DANCY_DEPS)
+	$(DANCY_O32)$@ ./kernel/base/pg_file.c
+
 ./o32/kernel/base/ret_user.o: \
     ./kernel/base/ret_user.c $(DANCY_DEPS)
 	$(DANCY_O32)$@ ./kernel/base/ret_user.c
@@ -1645,6 +1700,14 @@
     ./kernel/base/task.c $(DANCY_DEPS)
 	$(DANCY_O32)$@ ./kernel/base/task.c
 
+./o32/kernel/base/timer.o: \
+    ./kernel/base/timer.c $(DANCY_DEPS)
+	$(DANCY_O32)$@ ./kernel/base/timer.c
+
+./o32/kernel/base/waitq.o: \
+    ./kernel/base/waitq.c $(DANCY_DEPS)
+	$(DANCY_O32)$@ ./kernel/base/waitq.c
+
 ./o32/kernel/debug/debug.o: \
     ./kernel/debug/debug.c $(DANCY_DEPS)
 	$(DANCY_O32)$@ ./kernel/debug/debug.c
@@ -1889,6 +1952,10 @@
     ./kernel/usb/xhci.c $(DANCY_DEPS)
 	$(DANCY_O32)$@ ./kernel/usb/xhci.c
 
+./o32/kernel/vfs/bcache.o: \
+    ./kernel/vfs/bcache.c $(DANCY_DEPS)
+	$(DANCY_O32)$@ ./kernel/vfs/bcache.c
+
 ./o32/kernel/vfs/default.o: \
     ./kernel/vfs/default.c $(DANCY_DEPS)
 	$(DANCY_O32)$@ ./kernel/vfs/default.c
@@ -1919,6 +1986,41 @@
 
 ##############################################################################
 
+./o64/arctic/apps/bench/jitter.o: \
+    ./arctic/apps/bench/jitter.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O64)$@ ./arctic/apps/bench/jitter.c
+
+./o64/arctic/apps/bench/main.o: \
+    ./arctic/apps/bench/main.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O64)$@ ./arctic/apps/bench/main.c
+
+./o64/arctic/apps/bench/mmap.o: \
+    ./arctic/apps/bench/mmap.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O64)$@ ./arctic/apps/bench/mmap.c
+
+./o64/arctic/apps/bench/operate.o: \
+    ./arctic/apps/bench/operate.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O64)$@ ./arctic/apps/bench/operate.c
+
+./o64/arctic/apps/bench/pingpong.o: \
+    ./arctic/apps/bench/pingpong.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O64)$@ ./arctic/apps/bench/pingpong.c
+
+./o64/arctic/apps/bench/syscall.o: \
+    ./arctic/apps/bench/syscall.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O64)$@ ./arctic/apps/bench/syscall.c
+
+./o64/arctic/apps/bench/yield.o: \
+    ./arctic/apps/bench/yield.c $(DANCY_DEPS) \
+    $(ARCTIC_APPS_BENCH_HEADERS)
+	$(ARCTIC_O64)$@ ./arctic/apps/bench/yield.c
+
 ./o64/arctic/apps/hello/main.o: \
     ./arctic/apps/hello/main.c $(DANCY_DEPS) \
     $(ARCTIC_APPS_HELLO_HEADERS)
@@ -2173,6 +2275,10 @@
     ./arctic/libc/misc/proclist.c $(DANCY_DEPS)
 	$(ARCTIC_O64)$@ ./arctic/libc/misc/proclist.c
 
+./o64/arctic/libc/misc/setaffinity.o: \
+    ./arctic/libc/misc/setaffinity.c $(DANCY_DEPS)
+	$(ARCTIC_O64)$@ ./arctic/libc/misc/setaffinity.c
+
 ./o64/arctic/libc/poll/poll.o: \
     ./arctic/libc/poll/poll.c $(DANCY_DEPS)
 	$(ARCTIC_O64)$@ ./arctic/libc/poll/poll.c
@@ -2201,6 +2307,10 @@
     ./arctic/libc/regex/regfree.c $(DANCY_DEPS)
 	$(ARCTIC_O64)$@ ./arctic/libc/regex/regfree.c
 
+./o64/arctic/libc/sched/yield.o: \
+    ./arctic/libc/sched/yield.c $(DANCY_DEPS)
+	$(ARCTIC_O64)$@ ./arctic/libc/sched/yield.c
+
 ./o64/arctic/libc/signal/action.o: \
     ./arctic/libc/signal/action.c $(DANCY_DEPS)
 	$(ARCTIC_O64)$@ ./arctic/libc/signal/action.c
@@ -2245,6 +2355,10 @@
     ./arctic/libc/spawn/addopen.c $(DANCY_DEPS)
 	$(ARCTIC_O64)$@ ./arctic/libc/spawn/addopen.c
 
+./o64/arctic/libc/spawn/affinity.o: \
+    ./arctic/libc/spawn/affinity.c $(DANCY_DEPS)
+	$(ARCTIC_O64)$@ ./arctic/libc/spawn/affinity.c
+
 ./o64/arctic/libc/spawn/attr.o: \
     ./arctic/libc/spawn/attr.c $(DANCY_DEPS)
 	$(ARCTIC_O64)$@ ./arctic/libc/spawn/attr.c
@@ -2717,6 +2831,10 @@
     ./arctic/libc/sys/stat.c $(DANCY_DEPS)
 	$(ARCTIC_O64)$@ ./arctic/libc/sys/stat.c
 
+./o64/arctic/libc/sys/times.o: \
+    ./arctic/libc/sys/times.c $(DANCY_DEPS)
+	$(ARCTIC_O64)$@ ./arctic/libc/sys/times.c
+
 ./o64/arctic/libc/sys/umask.o: \
     ./arctic/libc/sys/umask.c $(DANCY_DEPS)
 	$(ARCTIC_O64)$@ ./arctic/libc/sys/umask.c
@@ -3614,6 +3732,10 @@
     ./kernel/base/pg.c $(DANCY_DEPS)
 	$(DANCY_O64)$@ ./kernel/base/pg.c
 
+./o64/kernel/base/pg_file.o: \
+    ./kernel/base/pg_file.c $(DANCY_DEPS)
+	$(DANCY_O64)$@ ./kernel/base/pg_file.c
+
 ./o64/kernel/base/ret_user.o: \
     ./kernel/base/ret_user.c $(DANCY_DEPS)
 	$(DANCY_O64)$@ ./kernel/base/ret_user.c
@@ -3634,6 +3756,14 @@
     ./kernel/base/task.c $(DANCY_DEPS)
 	$(DANCY_O64)$@ ./kernel/base/task.c
 
+./o64/kernel/base/timer.o: \
+    ./kernel/base/timer.c $(DANCY_DEPS)
+	$(DANCY_O64)$@ ./kernel/base/timer.c
+
+./o64/kernel/base/waitq.o: \
+    ./kernel/base/waitq.c $(DANCY_DEPS)
+	$(DANCY_O64)$@ ./kernel/base/waitq.c
+
 ./o64/kernel/debug/debug.o: \
     ./kernel/debug/debug.c $(DANCY_DEPS)
 	$(DANCY_O64)$@ ./kernel/debug/debug.c
@@ -3878,6 +4008,10 @@
     ./kernel/usb/xhci.c $(DANCY_DEPS)
 	$(DANCY_O64)$@ ./kernel/usb/xhci.c
 
+./o64/kernel/vfs/bcache.o: \
+    ./kernel/vfs/bcache.c $(DANCY_DEPS)
+	$(DANCY_O64)$@ ./kernel/vfs/bcache.c
+
 ./o64/kernel/vfs/default.o: \
     ./kernel/vfs/default.c $(DANCY_DEPS)
 	$(DANCY_O64)$@ ./kernel/vfs/default.c